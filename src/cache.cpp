@@ -1,4 +1,12 @@
 #include "cache.hpp"
+#include "skewed.hpp"
+#include "direct.hpp"
+#include "policies/rr.hpp"
+#include "policies/lru.hpp"
+#include "policies/lfu.hpp"
+#include "policies/random.hpp"
+#include <algorithm>
+#include <type_traits>
 
 namespace CacheSim {
 
@@ -7,15 +15,95 @@ namespace CacheSim {
 // ============================================================================
 
 Span<CacheLine> Cache::get_set(unsigned int index) {
+    if (sparse_sets.enabled) {
+        return Span<CacheLine>(reinterpret_cast<CacheLine*>(sparse_sets.set(this, index)), lines_per_set);
+    }
     return Span<CacheLine>(&storage[index * lines_per_set], lines_per_set);
 }
 
 uint64_t Cache::get_tag(uint64_t addr) const {
-    return addr >> (index_size + offset_size);
+    return addr >> tag_shift;
+}
+
+/* Rebuilds the line address (address >> offset_size) of a resident line from its tag and set */
+uint64_t Cache::line_of(uint64_t tag, uint64_t index) const {
+    if (tag_shift == offset_size) return tag;
+    return (tag << index_size) | index;
 }
 
+/**
+ * Sectors of the line holding lo touched by the byte range [lo, hi)
+ * The range is clipped to that line; unsectored caches always get the single whole-line bit
+ */
+uint32_t Cache::sector_mask(uint64_t lo, uint64_t hi) const {
+    if (sector_shift == offset_size) return 1;
+
+    uint64_t base = lo >> offset_size << offset_size;
+    uint64_t first = (lo - base) >> sector_shift;
+    uint64_t last = (hi - 1 - base) >> sector_shift;
+    uint64_t count = (uint64_t)1 << (offset_size - sector_shift);
+    if (hi - base > line_size) last = count - 1;
+
+    return (uint32_t)((((uint64_t)2 << last) - 1) & ~(((uint64_t)1 << first) - 1));
+}
+
+/**
+ * Maps an address to its set
+ * Plain bit selection on a power-of-two set count stays a shift and mask,
+ * everything else reduces with a multiply-shift remainder instead of a divide
+ */
 uint64_t Cache::get_index(uint64_t addr) const {
-    return (addr >> offset_size) & ((1ULL << index_size) - 1);
+    uint64_t line = addr >> offset_size;
+
+    switch (index_function) {
+        case IndexFunction::bit_select:
+            break;
+        case IndexFunction::xor_fold:
+            line = xor_fold(line, fold_bits);
+            break;
+        case IndexFunction::prime_modulo:
+            return set_mod.mod(line);
+        case IndexFunction::xor_matrix:
+            return CacheSim::xor_matrix(line, index_matrix);
+    }
+    return pow2_sets ? (line & index_mask) : set_mod.mod(line);
+}
+
+// ============================================================================
+// Sparse Set Store
+// ============================================================================
+
+namespace {
+
+inline size_t align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+}  // anonymous namespace
+
+void SparseSets::init(uint64_t num_sets, uint32_t lines_per_set, size_t line_state_bytes, size_t set_state_bytes) {
+    meta_offset = align8(lines_per_set * sizeof(CacheLine));
+    state_offset = align8(meta_offset + lines_per_set * line_state_bytes);
+    hint_offset = align8(state_offset + set_state_bytes);
+    set_bytes = align8(hint_offset + sizeof(uint32_t));
+
+    block_shift = 0;
+    while (((set_bytes << (block_shift + 1)) <= BLOCK_BYTES) && ((uint64_t)1 << (block_shift + 1)) <= num_sets) {
+        block_shift++;
+    }
+    block_mask = ((uint64_t)1 << block_shift) - 1;
+    blocks.assign((num_sets + block_mask) >> block_shift, std::vector<uint64_t>());
+    allocated_bytes = 0;
+    enabled = true;
+}
+
+/* Zeroed lines are invalid and empty; the policy then sets up its records as for a fresh cache */
+void SparseSets::allocate(Cache* cache, uint64_t block) {
+    uint64_t first = block << block_shift;
+    uint64_t count = std::min<uint64_t>(block_mask + 1, cache->num_sets - first);
+    blocks[block].assign((count * set_bytes) / sizeof(uint64_t), 0);
+    allocated_bytes += count * set_bytes;
+    init_sets(cache, first, count);
 }
 
 // ============================================================================
@@ -40,6 +128,9 @@ void calc_num_sets(Cache *c) {
         case CacheKind::_8way:
             c->num_sets = (uint32_t)(c->size / (8 * c->line_size));
             break;
+        case CacheKind::skewed:
+            c->num_sets = (uint32_t)(c->size / (c->ways * c->line_size));
+            break;
     }
 }
 
@@ -49,7 +140,7 @@ void calc_lines_per_set(Cache* c) {
 
 void calc_bit_counts(Cache* c) {
     unsigned int num_sets = c->num_sets;
-    unsigned int line_size = c->line_size;
+    uint64_t line_size = c->line_size;  // TLBs and walk caches use page-sized (or larger) lines
     unsigned int index_bits = 0;
     unsigned int offset_bits = 0;
 
@@ -60,262 +151,589 @@ void calc_bit_counts(Cache* c) {
     c->index_size = index_bits;
     c->offset_size = offset_bits;
     c->tag_size = 64 - (index_bits + offset_bits);
-}
-
-/* Helper to move a cache line to the Most Recently Used (head) position */
-void move_to_mru(Cache* cache, uint64_t set_idx, int32_t line_idx) {
-    auto set = cache->get_set(set_idx);
-    int32_t head = cache->lru_head[set_idx];
-    
-    if (head == line_idx) return; // Already at MRU
-
-    // Unlink from current position
-    int32_t prev = set[line_idx].prev;
-    int32_t next = set[line_idx].next;
-
-    if (prev != -1) set[prev].next = next;
-    if (next != -1) set[next].prev = prev;
-
-    // If it was the tail, update the tail
-    if (cache->lru_tail[set_idx] == line_idx) {
-        cache->lru_tail[set_idx] = prev;
-    }
-
-    // Move to head
-    set[line_idx].prev = -1;
-    set[line_idx].next = head;
-    if (head != -1) set[head].prev = line_idx;
-    
-    cache->lru_head[set_idx] = line_idx;
-}
 
-/* Swaps two elements in the LFU heap and updates their positions */
-void swap_heap(Cache* cache, uint32_t set_idx, int32_t h1, int32_t h2) {
-    uint32_t offset = set_idx * cache->lines_per_set;
-    int32_t line1 = cache->lfu_heaps[offset + h1];
-    int32_t line2 = cache->lfu_heaps[offset + h2];
-    
-    // Swap the elements in the heap array
-    cache->lfu_heaps[offset + h1] = line2;
-    cache->lfu_heaps[offset + h2] = line1;
-    
-    // Update the reverse mapping array
-    cache->heap_pos[offset + line1] = h2;
-    cache->heap_pos[offset + line2] = h1;
+    // Unsectored lines are a single sector
+    unsigned int sector_bits = 0;
+    size_t sector_size = c->sector_size ? c->sector_size : c->line_size;
+    while (sector_size >>= 1) sector_bits++;
+    c->sector_shift = sector_bits;
+    c->full_sectors = (uint32_t)(((uint64_t)1 << (1u << (offset_bits - sector_bits))) - 1);
 }
 
-/* Maintains the LFU heap property after access count changes, ensuring O(log n) victim selection  */
-void sift_down_lfu(Cache* cache, uint32_t set_idx, int32_t heap_idx) {
-    auto set = cache->get_set(set_idx);
-    uint32_t offset = set_idx * cache->lines_per_set;
-    int32_t size = cache->lines_per_set;
+/* Precomputes the reduction used by get_index and how much of the address the tag keeps */
+void calc_index_function(Cache* c) {
+    c->pow2_sets = (c->num_sets & (c->num_sets - 1)) == 0;
+    c->index_mask = c->num_sets - 1;
+    c->set_mod.init(c->num_sets);
 
-    /* Prefer smaller count, break ties with smaller physical index */
-    auto is_smaller = [&](int32_t line_a, int32_t line_b) {
-        if (set[line_a].access_count != set[line_b].access_count) {
-            return set[line_a].access_count < set[line_b].access_count;
-        }
-        return line_a < line_b; // Tie-breaker
-    };
-
-    while (true) {
-        int32_t left = 2 * heap_idx + 1;
-        int32_t right = 2 * heap_idx + 2;
-        int32_t smallest = heap_idx;
-
-        // Check left child
-        if (left < size) {
-            int32_t line_left = cache->lfu_heaps[offset + left];
-            int32_t line_smallest = cache->lfu_heaps[offset + smallest];
-            
-            if (is_smaller(line_left, line_smallest)) {
-                smallest = left;
-            }
-        }
+    // Round the fold width up so every set is reachable before reduction
+    c->fold_bits = c->index_size + (c->pow2_sets ? 0 : 1);
 
-        // Check right child
-        if (right < size) {
-            int32_t line_right = cache->lfu_heaps[offset + right];
-            int32_t line_smallest = cache->lfu_heaps[offset + smallest];
-            
-            if (is_smaller(line_right, line_smallest)) {
-                smallest = right;
-            }
-        }
+    // Prime modulo indexes the largest prime number of sets, leaving the remainder unused
+    if (c->index_function == IndexFunction::prime_modulo && c->num_sets > 2) {
+        c->set_mod.init(largest_prime_at_most(c->num_sets));
+    }
 
-        if (smallest != heap_idx) {
-            swap_heap(cache, set_idx, heap_idx, smallest);
-            heap_idx = smallest; // Continue sifting down
-        } else {
-            break;
-        }
+    // Prime modulo leaves the sets above the prime unused, a singular matrix every set off its image
+    c->reachable_sets = c->set_mod.d;
+    if (c->index_function == IndexFunction::xor_matrix && c->index_matrix.size() == c->index_size) {
+        c->reachable_sets = (uint64_t)1 << matrix_rank(c->index_matrix);
     }
+
+    // Only bit selection on a power-of-two set count lets the tag drop the index bits
+    bool plain = c->index_function == IndexFunction::bit_select && c->pow2_sets;
+    c->tag_shift = plain ? c->index_size + c->offset_size : c->offset_size;
+    if (!plain) c->tag_size = 64 - c->offset_size;
 }
 
 /**
  * Finds a matching cache line by tag, using a hash map for fully associative caches and linear scan otherwise
  * Linear scan is faster for lower associativity caches due to less overhead
+ * Only demand lookups train the way hint; the hierarchy's probes, inserts and writebacks just read it
  */
-int32_t find_hit_index(Cache* cache, uint64_t idx, uint64_t tag, Span<CacheLine> set) {
+int32_t find_hit_index(Cache* cache, uint64_t idx, uint64_t tag, Span<CacheLine> set, uint32_t* way_hint,
+                       bool train) {
     if (cache->kind == CacheKind::full) {
         auto& tag_map = cache->tag_maps[idx];
         auto it = tag_map.find(tag);
         return (it != tag_map.end()) ? it->second : -1;
     } 
     
-    // Linear scan for set-associative or direct mapped
+    // Set-associative: try the way this set last hit or filled, then scan the rest
+    if (way_hint) {
+        uint32_t hint = *way_hint;
+        if (set[hint].valid && set[hint].tag == tag) return hint;
+        for (uint32_t i = 0; i < cache->lines_per_set; ++i) {
+            if (i != hint && set[i].valid && set[i].tag == tag) {
+                if (train) *way_hint = i;
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Linear scan for direct mapped
     for (uint32_t i = 0; i < cache->lines_per_set; ++i) { 
         if (set[i].valid && set[i].tag == tag) return i;
     }
     return -1;
 }
 
-/* Updates metadata on a cache hit and adjusts replacement structures (LRU/LFU) */
-void process_hit(Cache* cache, uint64_t idx, int32_t hit_idx, uint64_t timer) {
-    cache->hits++;
-    auto set = cache->get_set(idx);
-    
-    set[hit_idx].last_access = timer;
-    set[hit_idx].access_count++;
-    
-    if (cache->replacement_policy == ReplacementPolicy::lru) {
-        move_to_mru(cache, idx, hit_idx); 
-    } else if (cache->replacement_policy == ReplacementPolicy::lfu) {
-        // Sift down  
-        uint32_t current_heap_pos = cache->heap_pos[idx * cache->lines_per_set + hit_idx];
-        sift_down_lfu(cache, idx, current_heap_pos);
+/* Updates metadata on a cache hit and adjusts the policy's replacement structures */
+template <typename Policy>
+void process_hit(SetView<Policy> set, int32_t hit_idx, uint64_t timer) {
+    set.cache->hits++;
+
+    set.lines[hit_idx].last_access = timer;
+    set.lines[hit_idx].access_count++;
+    if (set.lines[hit_idx].prefetched) {
+        set.lines[hit_idx].prefetched = false;
+        set.cache->prefetcher.useful++;
     }
+
+    Policy::on_hit(set, hit_idx);
 }
 
 /* Selects a victim line for replacement based on policy */
-int32_t select_victim(Cache* cache, uint64_t idx, Span<CacheLine> set) {
-    
-    // O(1) LFU Victim Selection 
-    if (cache->replacement_policy == ReplacementPolicy::lfu) {
-        return cache->lfu_heaps[idx * cache->lines_per_set + 0]; // Root of the heap
-    } 
-
+template <typename Policy>
+int32_t select_victim(SetView<Policy> set) {
     // Check for invalid (empty) lines first
-    for (uint32_t i = 0; i < cache->lines_per_set; ++i) {
-        if (!set[i].valid) return i; 
+    if (Policy::fills_invalid_first) {
+        for (uint32_t i = 0; i < set.ways(); ++i) {
+            if (!set.lines[i].valid) return i;
+        }
     }
 
-    // Fallback to other replacement policies
-    if (cache->kind == CacheKind::direct) {
+    // Direct mapped caches have a single candidate
+    if (set.cache->kind == CacheKind::direct) {
         return 0;
-    } else if (cache->replacement_policy == ReplacementPolicy::lru) {
-        return cache->lru_tail[idx];
-    } else {
-        // Round Robin
-        int32_t victim = cache->rr_counters[idx];
-        cache->rr_counters[idx] = (victim + 1) % cache->lines_per_set;
-        return victim;
     }
+    return Policy::victim(set);
 }
 
 /**
  * Handles eviction and replacement, updating all relevant structures
  */
-void replace_victim(Cache* cache, uint64_t idx, int32_t victim, uint64_t tag, uint64_t timer) {
-    auto set = cache->get_set(idx);
+template <typename Policy>
+void replace_victim(SetView<Policy> set, uint64_t idx, int32_t victim, uint64_t tag, uint64_t timer, bool dirty,
+                    uint32_t sectors, bool prefetched) {
+    Cache* cache = set.cache;
 
     // Update Fully Associative Hash Map
+    if (!set.lines[victim].valid) cache->valid_lines++;
+
     if (cache->kind == CacheKind::full) {
         auto& tag_map = cache->tag_maps[idx];
-        if (set[victim].valid) tag_map.erase(set[victim].tag);
+        if (set.lines[victim].valid) tag_map.erase(set.lines[victim].tag);
         tag_map[tag] = victim;
     }
 
+    if (set.hint) *set.hint = victim;
+
     // Overwrite victim
-    set[victim].valid = true;
-    set[victim].tag = tag;
-    set[victim].last_access = timer;
-    set[victim].access_count = 1;
+    set.lines[victim].valid = true;
+    set.lines[victim].dirty = dirty;
+    set.lines[victim].prefetched = prefetched;
+    set.lines[victim].sectors = sectors;
+    set.lines[victim].tag = tag;
+    set.lines[victim].last_access = timer;
+    set.lines[victim].access_count = 1;
 
     // Update replacement policy structures for the new line
-    if (cache->replacement_policy == ReplacementPolicy::lru) {
-        move_to_mru(cache, idx, victim);
-    } else if (cache->replacement_policy == ReplacementPolicy::lfu) {
-        // The root count changed to exactly 1. Sift down to re-balance.
-        sift_down_lfu(cache, idx, 0); 
+    Policy::on_fill(set, victim);
+}
+
+/* Records the line leaving this level, so the hierarchy can act on it */
+inline void record_eviction(Cache* cache, uint64_t line, bool dirty, bool prefetched = false) {
+    cache->evicted.valid = true;
+    cache->evicted.dirty = dirty;
+    cache->evicted.prefetched = prefetched;
+    cache->evicted.addr = line << cache->offset_size;
+}
+
+/**
+ * Main-array miss with a victim buffer attached
+ * The line evicted from the array moves into the buffer; if the requested line was in the buffer
+ * it takes the evicted line's place there (a swap) and the access is served without going further.
+ * Only a line displaced from the buffer leaves the level.
+ */
+template <typename Policy>
+bool victim_cache_exchange(SetView<Policy> set, uint64_t idx, int32_t victim_idx, uint64_t tag,
+                           uint64_t line, uint64_t timer, bool dirty, uint32_t sectors, bool prefetched) {
+    Cache* cache = set.cache;
+    VictimCache& vc = cache->victim;
+
+    const CacheLine& evicted = set.lines[victim_idx];
+    uint64_t evicted_line = evicted.valid ? cache->line_of(evicted.tag, idx) : VictimCache::EMPTY;
+    bool evicted_dirty = evicted.valid && evicted.dirty;
+
+    // The buffer does not track prefetched lines, leaving the array unused counts as unused
+    if (evicted.valid && evicted.prefetched) cache->prefetcher.unused++;
+
+    int32_t slot = vc.find(line);
+    bool hit = slot != -1;
+    if (hit) {
+        vc.hits++;
+        dirty |= vc.dirty[slot] != 0;
+    } else if (evicted.valid) {
+        slot = vc.slot_for_insert();
+        if (vc.tags[slot] != VictimCache::EMPTY) record_eviction(cache, vc.tags[slot], vc.dirty[slot]);
     }
+
+    if (slot != -1) vc.put(slot, evicted_line, timer, evicted_dirty);
+    replace_victim(set, idx, victim_idx, tag, timer, dirty, sectors, prefetched && !hit);
+    return hit;
 }
 
+/**
+ * Brings a line into the set after a miss, returns true if it was served by the victim buffer
+ * cache->evicted is left describing the line that left the level, if any
+ */
+template <typename Policy>
+bool fill_line(SetView<Policy> set, uint64_t idx, uint64_t tag, uint64_t line, uint64_t timer, bool dirty,
+               uint32_t sectors, bool prefetched = false) {
+    Cache* cache = set.cache;
+    cache->evicted.valid = false;
+    int32_t victim_idx = select_victim(set);
+
+    if (cache->victim.entries) {
+        return victim_cache_exchange(set, idx, victim_idx, tag, line, timer, dirty, sectors, prefetched);
+    }
+
+    const CacheLine& old = set.lines[victim_idx];
+    if (old.valid) {
+        record_eviction(cache, cache->line_of(old.tag, idx), old.dirty, old.prefetched);
+        if (old.prefetched) cache->prefetcher.unused++;
+    }
+    replace_victim(set, idx, victim_idx, tag, timer, dirty, sectors, prefetched);
+    return false;
+}
+
+/**
+ * Tag hit on a sectored line with some of the needed sectors absent
+ * Counts as a miss: the missing sectors are fetched into the line in place and nothing is evicted
+ */
+template <typename Policy>
+bool sector_miss(SetView<Policy> set, int32_t way, uint32_t missing, uint64_t timer, bool write) {
+    Cache* cache = set.cache;
+    CacheLine& line = set.lines[way];
+
+    cache->misses++;
+    cache->sector_misses++;
+    cache->evicted.valid = false;
+    if (write) {
+        cache->write_misses++;
+        if (!cache->write_allocate) return false;
+    }
+
+    cache->sector_fills += __builtin_popcount(missing);
+    line.sectors |= missing;
+    line.dirty |= write && cache->write_back;
+    line.last_access = timer;
+    line.access_count++;
+    Policy::on_hit(set, way);
+    return false;
+}
+
+/**
+ * Checks if an address is a hit or miss for a specific cache.
+ * Instantiated once per policy, so policy hooks are inlined into the access path.
+ * Stores dirty the line in write-back caches; without write-allocate a store miss does not fill.
+ */
+template <typename Policy>
+bool access_impl(Cache* cache, uint64_t addr, uint64_t timer, bool write, uint32_t sectors) {
+    uint64_t idx = cache->get_index(addr);
+    uint64_t tag = cache->get_tag(addr);
+    auto set = SetView<Policy>::at(cache, idx);
+
+    // 1. Check for Hit
+    uint32_t predicted = set.hint ? *set.hint : 0;
+    int32_t hit_idx = find_hit_index(cache, idx, tag, set.lines, set.hint, true);
+
+    if (hit_idx != -1) {
+        if (set.hint) {
+            if ((uint32_t)hit_idx == predicted) cache->way_hint_hits++;
+            else cache->way_hint_misses++;
+        }
+        uint32_t missing = sectors & ~set.lines[hit_idx].sectors;
+        if (missing) {
+            cache->last_hit_line = ~0ULL;
+            return sector_miss(set, hit_idx, missing, timer, write);
+        }
+
+        process_hit(set, hit_idx, timer);
+        if (write) {
+            cache->write_hits++;
+            set.lines[hit_idx].dirty |= cache->write_back;
+        }
+        cache->last_hit_line = addr >> cache->offset_size;
+        cache->last_hit_set = idx;
+        cache->last_hit_way = hit_idx;
+        return true;
+    }
+
+    // 2. Handle Miss
+    cache->last_hit_line = ~0ULL;
+    cache->misses++;
+    uint64_t line = addr >> cache->offset_size;
+
+    if (write) {
+        cache->write_misses++;
+        if (!cache->write_allocate) {
+            cache->evicted.valid = false;
+
+            // A store can still complete in the victim buffer without allocating
+            int32_t slot = cache->victim.entries ? cache->victim.find(line) : -1;
+            if (slot == -1) return false;
+            cache->victim.hits++;
+            cache->victim.dirty[slot] |= cache->write_back;
+            return true;
+        }
+    }
+    cache->sector_fills += __builtin_popcount(sectors);
+    return fill_line(set, idx, tag, line, timer, write && cache->write_back, sectors);
+}
+
+/**
+ * The hit path of access_impl for the recorded last-hit line, skipping index, tag and way search
+ * The way hint is trained as the full lookup would have trained it
+ */
+template <typename Policy>
+void repeat_hit_impl(Cache* cache, uint64_t timer, bool write) {
+    auto set = SetView<Policy>::at(cache, cache->last_hit_set);
+    int32_t way = cache->last_hit_way;
+
+    if (set.hint) {
+        if (*set.hint == (uint32_t)way) {
+            cache->way_hint_hits++;
+        } else {
+            cache->way_hint_misses++;
+            *set.hint = way;
+        }
+    }
+
+    process_hit(set, way, timer);
+    if (write) {
+        cache->write_hits++;
+        set.lines[way].dirty |= cache->write_back;
+    }
+}
+
+/* Lookup without touching statistics or replacement state */
+template <typename Policy>
+bool probe_impl(Cache* cache, uint64_t addr) {
+    uint64_t idx = cache->get_index(addr);
+    auto set = SetView<Policy>::at(cache, idx);
+    if (find_hit_index(cache, idx, cache->get_tag(addr), set.lines, set.hint, false) != -1) return true;
+    return cache->victim.entries && cache->victim.find(addr >> cache->offset_size) != -1;
+}
+
+/* Places a line that arrives from another level or a prefetch (not a demand access), without statistics */
+template <typename Policy>
+void insert_impl(Cache* cache, uint64_t addr, uint64_t timer, bool dirty, bool prefetched) {
+    uint64_t idx = cache->get_index(addr);
+    uint64_t tag = cache->get_tag(addr);
+    uint64_t line = addr >> cache->offset_size;
+    auto set = SetView<Policy>::at(cache, idx);
+
+    cache->evicted.valid = false;
+    cache->last_hit_line = ~0ULL;
+    int32_t way = find_hit_index(cache, idx, tag, set.lines, set.hint, false);
+    if (way != -1) {
+        // A resident sectored line may be partial; the arriving copy is complete
+        set.lines[way].sectors |= cache->full_sectors;
+        set.lines[way].dirty |= dirty;
+        return;
+    }
+
+    // The array copy supersedes one parked in the victim buffer
+    if (cache->victim.entries) {
+        int32_t slot = cache->victim.find(line);
+        if (slot != -1) {
+            dirty |= cache->victim.dirty[slot] != 0;
+            cache->victim.tags[slot] = VictimCache::EMPTY;
+        }
+    }
+    fill_line(set, idx, tag, line, timer, dirty, cache->full_sectors, prefetched);
+}
+
+/* Drops a line from the array or victim buffer, returns true if it was present */
+template <typename Policy>
+bool invalidate_impl(Cache* cache, uint64_t addr) {
+    uint64_t idx = cache->get_index(addr);
+    uint64_t tag = cache->get_tag(addr);
+    uint64_t line = addr >> cache->offset_size;
+    auto set = SetView<Policy>::at(cache, idx);
+
+    cache->last_hit_line = ~0ULL;
+    int32_t way = find_hit_index(cache, idx, tag, set.lines, set.hint, false);
+    if (way != -1) {
+        if (cache->kind == CacheKind::full) cache->tag_maps[idx].erase(tag);
+        record_eviction(cache, line, set.lines[way].dirty, set.lines[way].prefetched);
+        set.lines[way].valid = false;
+        cache->valid_lines--;
+        set.lines[way].dirty = false;
+        set.lines[way].prefetched = false;
+        set.lines[way].access_count = 0;
+        Policy::on_invalidate(set, way);
+        return true;
+    }
+
+    if (cache->victim.entries) {
+        int32_t slot = cache->victim.find(line);
+        if (slot != -1) {
+            record_eviction(cache, line, cache->victim.dirty[slot]);
+            cache->victim.tags[slot] = VictimCache::EMPTY;
+            return true;
+        }
+    }
+    cache->evicted.valid = false;
+    return false;
+}
+
+/* Marks a resident line dirty (an incoming writeback), returns false if absent */
+template <typename Policy>
+bool mark_dirty_impl(Cache* cache, uint64_t addr) {
+    uint64_t idx = cache->get_index(addr);
+    auto set = SetView<Policy>::at(cache, idx);
+
+    int32_t way = find_hit_index(cache, idx, cache->get_tag(addr), set.lines, set.hint, false);
+    if (way != -1) {
+        set.lines[way].dirty = true;
+        return true;
+    }
+
+    if (cache->victim.entries) {
+        int32_t slot = cache->victim.find(addr >> cache->offset_size);
+        if (slot != -1) {
+            cache->victim.dirty[slot] = 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Lets the policy set up count fresh sets starting at first */
+template <typename Policy>
+void init_sets(Cache* cache, uint64_t first, uint64_t count) {
+    for (uint64_t s = first; s < first + count; s++) {
+        Policy::init(SetView<Policy>::at(cache, s));
+    }
+}
+
+/**
+ * Allocates the policy's metadata arrays (zeroed) and lets it initialise every set
+ * A sparse cache only records the sizes; each block is set up when first touched
+ */
+template <typename Policy>
+void init_policy(Cache* cache) {
+    using LineState = typename Policy::LineState;
+    using SetState = typename Policy::SetState;
+    static_assert(std::is_base_of<PolicyBase<Policy>, Policy>::value, "policies derive from PolicyBase");
+    static_assert(std::is_trivially_copyable<LineState>::value && std::is_trivially_copyable<SetState>::value,
+                  "policy state must be plain data");
+
+    size_t line_state_bytes = std::is_empty<LineState>::value ? 0 : sizeof(LineState);
+    size_t set_state_bytes = std::is_empty<SetState>::value ? 0 : sizeof(SetState);
+    if (cache->sparse_sets.enabled) {
+        cache->sparse_sets.init(cache->num_sets, cache->lines_per_set, line_state_bytes, set_state_bytes);
+        cache->sparse_sets.init_sets = &init_sets<Policy>;
+        return;
+    }
+
+    size_t lines = (size_t)cache->num_sets * cache->lines_per_set;
+    cache->line_meta.assign(lines * line_state_bytes, 0);
+    cache->set_meta.assign(cache->num_sets * set_state_bytes, 0);
+    init_sets<Policy>(cache, 0, cache->num_sets);
+}
+
+template <typename Policy>
+constexpr EngineOps make_policy_ops() {
+    return EngineOps{Policy::name, &init_policy<Policy>, &access_impl<Policy>, &probe_impl<Policy>,
+                     &insert_impl<Policy>, &invalidate_impl<Policy>, &mark_dirty_impl<Policy>,
+                     &repeat_hit_impl<Policy>};
+}
+
+/**
+ * Replacement policy registry, maps config strings to engine instantiations
+ * Adding a policy means writing its header under policies/ and listing it here
+ */
+constexpr EngineOps policy_registry[] = {
+    make_policy_ops<RoundRobinPolicy>(),
+    make_policy_ops<LruPolicy>(),
+    make_policy_ops<LfuPolicy>(),
+    make_policy_ops<RandomPolicy>(),
+};
+
 }  // anonymous namespace
 
 // ============================================================================
 // Main API
 // ============================================================================
 
+const EngineOps* find_policy(const std::string& name) {
+    for (const auto& ops : policy_registry) {
+        if (name == ops.name) return &ops;
+    }
+    return nullptr;
+}
+
 /**
- * Initialises cache structures, including LRU lists and LFU heaps, keeping storage contiguous and efficient.
+ * Initialises cache structures and the replacement policy's metadata, keeping storage contiguous and efficient.
+ * Skewed caches keep rows of one slot per way in the same storage but run their own engine.
+ * Set-indexed caches whose lines would take more than SparseSets::THRESHOLD_BYTES use the sparse store.
  */
-void init_cache(Cache* cache) {
+bool init_cache(Cache* cache) {
     calc_num_sets(cache);
     calc_lines_per_set(cache);
     calc_bit_counts(cache);
-    
-    cache->storage.resize(cache->num_sets * cache->lines_per_set);
-    cache->rr_counters.resize(cache->num_sets, 0);
-    cache->tag_maps.resize(cache->num_sets);
+    calc_index_function(cache);
 
-    // Initialise LRU structures
-    if (cache->replacement_policy == ReplacementPolicy::lru) {
-        cache->lru_head.resize(cache->num_sets, -1);
-        cache->lru_tail.resize(cache->num_sets, -1);
+    cache->rng.seed(cache->seed);
 
-        for (unsigned int s = 0; s < cache->num_sets; s++) {
-            auto set = cache->get_set(s);
+    size_t dense_bytes = (size_t)cache->num_sets * cache->lines_per_set * sizeof(CacheLine);
+    bool set_indexed = cache->kind != CacheKind::full && cache->kind != CacheKind::skewed;
+    bool sparse = set_indexed && cache->sparse.value_or(dense_bytes > SparseSets::THRESHOLD_BYTES);
 
-            cache->lru_head[s] = 0;
-            cache->lru_tail[s] = cache->lines_per_set - 1;
+    // Plain direct-mapped caches keep only a packed tag array
+    if (cache->kind == CacheKind::direct && cache->sector_shift == cache->offset_size && !cache->victim.entries &&
+        !sparse) {
+        return init_direct(cache);
+    }
 
-            // Pre-link all lines in the set
-            for (unsigned int i = 0; i < cache->lines_per_set; i++) {
-                set[i].prev = i - 1;
-                set[i].next = (i == cache->lines_per_set - 1) ? -1 : i + 1;
-            }
-        }
-    } 
-    // Initialise LFU structures
-    else if (cache->replacement_policy == ReplacementPolicy::lfu) {
-        uint32_t total_lines = cache->num_sets * cache->lines_per_set;
-        cache->lfu_heaps.resize(total_lines);
-        cache->heap_pos.resize(total_lines);
-        
-        for (uint32_t s = 0; s < cache->num_sets; s++) {
-            for (uint32_t i = 0; i < cache->lines_per_set; i++) {
-                uint32_t idx = s * cache->lines_per_set + i;
-                // Initialise heap such that line i is at heap position i 
-                cache->lfu_heaps[idx] = i;
-                cache->heap_pos[idx] = i;
-            }
-        }
+    if (cache->kind == CacheKind::full) cache->tag_maps.resize(cache->num_sets);
+    if (cache->kind == CacheKind::skewed) {
+        cache->storage.resize(cache->num_sets * cache->lines_per_set);
+        return init_skewed(cache);
     }
+
+    // The policy's init lays out the sparse store, or the dense arrays allocated here
+    cache->way_hinting = set_indexed && cache->lines_per_set > 1;
+    cache->sparse_sets.enabled = sparse;
+    if (!sparse) {
+        cache->storage.resize(cache->num_sets * cache->lines_per_set);
+        if (cache->way_hinting) cache->way_hints.assign(cache->num_sets, 0);
+    }
+
+    cache->engine = find_policy(cache->replacement_policy);
+    if (!cache->engine) return false;
+    cache->engine->init(cache);
+    cache->access_fn = cache->engine->access;
+    return true;
+}
+
+namespace {
+
+/* Feeds one demand access to the cache's enabled analyses */
+void observe_line(Cache* cache, uint64_t line, bool miss) {
+    if (cache->miss_classes.enabled()) cache->miss_classes.observe(line, miss);
+    if (cache->reuse.enabled()) cache->reuse.observe(line);
 }
 
 /**
- * Checks if an address is a hit or miss for a specific cache.
+ * Engine access followed by the cache's analyses, which see the line of every demand access
+ * Misses are read off the counters, since victim buffer swaps count as misses but return true;
+ * sector misses keep their line resident and are not classified.
  */
-bool access_cache(Cache* cache, uint64_t addr, uint64_t timer) {
+bool observed_access(Cache* cache, uint64_t addr, uint64_t timer, bool write, uint32_t sectors) {
+    uint64_t misses = cache->misses;
+    uint64_t sector_misses = cache->sector_misses;
+    bool hit = cache->engine->access(cache, addr, timer, write, sectors);
+    observe_line(cache, addr >> cache->offset_size,
+                 cache->misses != misses && cache->sector_misses == sector_misses);
+    return hit;
+}
+
+}  // anonymous namespace
+
+void observe_accesses(Cache* cache) {
+    cache->access_fn = &observed_access;
+}
+
+bool lookup_line(Cache* cache, uint64_t addr) {
+    bool hit = cache->engine->probe(cache, addr);
+    if (hit) cache->hits++;
+    else cache->misses++;
+    observe_line(cache, addr >> cache->offset_size, !hit);
+    return hit;
+}
+
+size_t host_footprint(const Cache* cache) {
+    return cache->storage.size() * sizeof(CacheLine) + cache->line_meta.size() + cache->set_meta.size() +
+           cache->way_hints.size() * sizeof(uint32_t) + cache->direct_tags.size() * (sizeof(uint64_t) + 1) +
+           cache->sparse_sets.blocks.size() * sizeof(std::vector<uint64_t>) + cache->sparse_sets.allocated_bytes;
+}
+
+/**
+ * A set may span several host cache lines, each is prefetched. Skewed and fully associative
+ * caches have no single set to fetch and are left alone, as are sparse sets not yet allocated.
+ */
+void prefetch_set(const Cache* cache, uint64_t addr) {
+    constexpr size_t HOST_LINE = 64;
     uint64_t idx = cache->get_index(addr);
-    uint64_t tag = cache->get_tag(addr);
-    auto set = cache->get_set(idx);
 
-    // 1. Check for Hit
-    int32_t hit_idx = find_hit_index(cache, idx, tag, set);
+    if (!cache->direct_tags.empty()) {
+        __builtin_prefetch(&cache->direct_tags[idx]);
+        __builtin_prefetch(&cache->direct_flags[idx]);
+        return;
+    }
+    if (cache->kind == CacheKind::skewed || cache->kind == CacheKind::full) return;
 
-    if (hit_idx != -1) {
-        process_hit(cache, idx, hit_idx, timer);
-        return true;
+    if (cache->sparse_sets.enabled) {
+        const unsigned char* set = cache->sparse_sets.find(idx);
+        if (!set) return;
+        for (size_t b = 0; b < cache->sparse_sets.set_bytes; b += HOST_LINE) __builtin_prefetch(set + b);
+        return;
     }
 
-    // 2. Handle Miss
-    cache->misses++;
-    int32_t victim_idx = select_victim(cache, idx, set);
-    replace_victim(cache, idx, victim_idx, tag, timer);
+    const char* lines = reinterpret_cast<const char*>(&cache->storage[idx * cache->lines_per_set]);
+    for (size_t b = 0; b < cache->lines_per_set * sizeof(CacheLine); b += HOST_LINE) __builtin_prefetch(lines + b);
 
-    return false;
+    size_t meta_bytes = cache->line_meta.size() / cache->num_sets;
+    for (size_t b = 0; b < meta_bytes; b += HOST_LINE) __builtin_prefetch(&cache->line_meta[idx * meta_bytes + b]);
+    size_t state_bytes = cache->set_meta.size() / cache->num_sets;
+    if (state_bytes) __builtin_prefetch(&cache->set_meta[idx * state_bytes]);
+    if (!cache->way_hints.empty()) __builtin_prefetch(&cache->way_hints[idx]);
 }
 
-}  // namespace CacheSim
\ No newline at end of file
+}  // namespace CacheSim
@@ -0,0 +1,92 @@
+#include "classify.hpp"
+#include "cache.hpp"
+
+namespace CacheSim {
+
+// ============================================================================
+// Shadow LRU
+// ============================================================================
+
+void ShadowLru::init(uint64_t capacity) {
+    capacity_ = capacity;
+    lines_.clear();
+    prev_.clear();
+    next_.clear();
+    head_ = tail_ = NIL;
+    slots_ = LineTable<uint32_t>();
+}
+
+void ShadowLru::unlink(uint32_t slot) {
+    if (prev_[slot] != NIL) next_[prev_[slot]] = next_[slot];
+    else head_ = next_[slot];
+    if (next_[slot] != NIL) prev_[next_[slot]] = prev_[slot];
+    else tail_ = prev_[slot];
+}
+
+void ShadowLru::push_front(uint32_t slot) {
+    prev_[slot] = NIL;
+    next_[slot] = head_;
+    if (head_ != NIL) prev_[head_] = slot;
+    else tail_ = slot;
+    head_ = slot;
+}
+
+bool ShadowLru::access(uint64_t line) {
+    if (uint32_t* found = slots_.find(line)) {
+        uint32_t slot = *found;
+        if (slot != head_) {
+            unlink(slot);
+            push_front(slot);
+        }
+        return true;
+    }
+
+    // Miss: take a fresh slot until the capacity is reached, then recycle the least recently used
+    uint32_t slot;
+    if (lines_.size() < capacity_) {
+        slot = (uint32_t)lines_.size();
+        lines_.push_back(line);
+        prev_.push_back(NIL);
+        next_.push_back(NIL);
+    } else {
+        slot = tail_;
+        unlink(slot);
+        slots_.erase(lines_[slot]);
+        lines_[slot] = line;
+    }
+    slots_[line] = slot;
+    push_front(slot);
+    return false;
+}
+
+// ============================================================================
+// Miss Classifier
+// ============================================================================
+
+void MissClassifier::init(uint64_t lines) {
+    compulsory = capacity = conflict = 0;
+    shadow_.init(lines);
+    seen_ = LineTable<uint64_t>();
+    enabled_ = true;
+}
+
+void MissClassifier::observe(uint64_t line, bool miss) {
+    bool shadow_hit = shadow_.access(line);
+
+    uint64_t& seen = seen_[line >> 6];
+    uint64_t bit = (uint64_t)1 << (line & 63);
+    bool first = !(seen & bit);
+    seen |= bit;
+
+    if (!miss) return;
+    if (first) compulsory++;
+    else if (!shadow_hit) capacity++;
+    else conflict++;
+}
+
+void classify_misses(Cache* cache) {
+    cache->miss_classes.init((uint64_t)cache->num_sets * cache->lines_per_set);
+    observe_accesses(cache);
+}
+
+}  // namespace CacheSim
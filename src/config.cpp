@@ -1,7 +1,9 @@
 #include "config.hpp"
+#include "skewed.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cstdlib>
 #include <rapidjson/document.h>
 #include <rapidjson/error/en.h>
 
@@ -14,13 +16,333 @@ CacheKind parse_cache_kind(const std::string& s) {
     if (s == "2way") return CacheKind::_2way;
     if (s == "4way") return CacheKind::_4way;
     if (s == "8way") return CacheKind::_8way;
+    if (s == "skewed") return CacheKind::skewed;
     return CacheKind::direct; // default
 }
 
-ReplacementPolicy parse_replacement_policy(const std::string& s) {
-    if (s == "lru") return ReplacementPolicy::lru;
-    if (s == "lfu") return ReplacementPolicy::lfu;
-    return ReplacementPolicy::rr; // default
+/* Returns false for unknown index function names */
+bool parse_index_function(const std::string& s, IndexFunction* out) {
+    if (s == "bit_select") *out = IndexFunction::bit_select;
+    else if (s == "xor_fold") *out = IndexFunction::xor_fold;
+    else if (s == "prime_modulo") *out = IndexFunction::prime_modulo;
+    else if (s == "xor_matrix") *out = IndexFunction::xor_matrix;
+    else return false;
+    return true;
+}
+
+/* Returns false for unknown prefetcher names */
+bool parse_prefetcher_kind(const std::string& s, PrefetcherKind* out) {
+    if (s == "none") *out = PrefetcherKind::none;
+    else if (s == "next_line") *out = PrefetcherKind::next_line;
+    else if (s == "stream") *out = PrefetcherKind::stream;
+    else if (s == "stride") *out = PrefetcherKind::stride;
+    else return false;
+    return true;
+}
+
+/* Reads a 64-bit value given either as a JSON number or as a (hex) string such as "0x1f0" */
+bool parse_u64(const rapidjson::Value& v, uint64_t* out) {
+    if (v.IsUint64()) {
+        *out = v.GetUint64();
+        return true;
+    }
+    if (v.IsString()) {
+        char* end = nullptr;
+        *out = std::strtoull(v.GetString(), &end, 0);
+        return end && *end == '\0';
+    }
+    return false;
+}
+
+/**
+ * Builds a TLB or walk cache from {"entries", "kind", "replacement_policy"}
+ * Its lines are `span` bytes (a page, or the range a table entry maps); defaults to 4-way LRU
+ */
+int parse_translation_cache(const rapidjson::Value& v, const std::string& name, uint64_t span, Cache* cache) {
+    if (!v.IsObject() || !v.HasMember("entries") || !v["entries"].IsUint() || v["entries"].GetUint() == 0) {
+        std::cerr << name << ": needs a positive \"entries\"" << std::endl;
+        return 1;
+    }
+
+    cache->name = name;
+    cache->line_size = span;
+    cache->size = v["entries"].GetUint() * span;
+    cache->kind = CacheKind::_4way;
+    cache->replacement_policy = "lru";
+    if (v.HasMember("kind") && v["kind"].IsString()) cache->kind = parse_cache_kind(v["kind"].GetString());
+    if (v.HasMember("replacement_policy") && v["replacement_policy"].IsString())
+        cache->replacement_policy = v["replacement_policy"].GetString();
+
+    if (cache->kind == CacheKind::skewed || !init_cache(cache)) {
+        std::cerr << name << ": unsupported kind or replacement policy" << std::endl;
+        return 1;
+    }
+    if (cache->num_sets == 0) {
+        std::cerr << name << ": fewer entries than ways" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Parses the optional "tlbs" section
+ * "pages" lists one entry per page size (4K, 2M or 1G) with an "l1" and optional "l2" TLB,
+ * "walk_caches" caches upper table levels ("pml4", "pdpt" or "pd"), and "regions" maps address
+ * ranges to page sizes; everything else uses "default_page_size" (the smallest page size if absent).
+ */
+int parse_tlbs(const rapidjson::Value& v, Tlb* tlb) {
+    if (!v.HasMember("pages") || !v["pages"].IsArray() || v["pages"].Empty()) {
+        std::cerr << "tlbs: needs a non-empty \"pages\" array" << std::endl;
+        return 1;
+    }
+
+    for (const auto& p : v["pages"].GetArray()) {
+        PageClass pc;
+        pc.page_size = p.HasMember("page_size") && p["page_size"].IsUint64() ? p["page_size"].GetUint64() : 0;
+        if (pc.page_size == (1ULL << 12)) pc.leaf_level = 3;
+        else if (pc.page_size == (1ULL << 21)) pc.leaf_level = 2;
+        else if (pc.page_size == (1ULL << 30)) pc.leaf_level = 1;
+        else {
+            std::cerr << "tlbs: page_size must be 4096, 2097152 or 1073741824" << std::endl;
+            return 1;
+        }
+        for (const auto& other : tlb->classes) {
+            if (other.page_size == pc.page_size) {
+                std::cerr << "tlbs: page_size " << pc.page_size << " listed twice" << std::endl;
+                return 1;
+            }
+        }
+
+        std::string name = "tlb" + std::to_string(pc.page_size);
+        if (!p.HasMember("l1")) {
+            std::cerr << "tlbs: page_size " << pc.page_size << " needs an \"l1\" TLB" << std::endl;
+            return 1;
+        }
+        if (parse_translation_cache(p["l1"], name + "_l1", pc.page_size, &pc.l1) != 0) return 1;
+        if (p.HasMember("l2")) {
+            if (parse_translation_cache(p["l2"], name + "_l2", pc.page_size, &pc.l2) != 0) return 1;
+            pc.has_l2 = true;
+        }
+        tlb->classes.push_back(pc);
+    }
+
+    // Default to the smallest page size
+    for (size_t i = 1; i < tlb->classes.size(); i++) {
+        if (tlb->classes[i].page_size < tlb->classes[tlb->default_class].page_size) tlb->default_class = i;
+    }
+
+    // Index of the class for a page size, or -1
+    auto find_class = [tlb](uint64_t page_size) {
+        for (size_t i = 0; i < tlb->classes.size(); i++) {
+            if (tlb->classes[i].page_size == page_size) return (int)i;
+        }
+        return -1;
+    };
+
+    if (v.HasMember("default_page_size")) {
+        int index = v["default_page_size"].IsUint64() ? find_class(v["default_page_size"].GetUint64()) : -1;
+        if (index == -1) {
+            std::cerr << "tlbs: default_page_size must be one of the configured page sizes" << std::endl;
+            return 1;
+        }
+        tlb->default_class = index;
+    }
+
+    if (v.HasMember("walk_caches") && v["walk_caches"].IsArray()) {
+        for (const auto& w : v["walk_caches"].GetArray()) {
+            std::string level = w.HasMember("level") && w["level"].IsString() ? w["level"].GetString() : "";
+            WalkCache wc;
+            if (level == "pml4") wc.level = 0;
+            else if (level == "pdpt") wc.level = 1;
+            else if (level == "pd") wc.level = 2;
+            else {
+                std::cerr << "tlbs: walk cache level must be pml4, pdpt or pd" << std::endl;
+                return 1;
+            }
+            for (const auto& other : tlb->walk_caches) {
+                if (other.level == wc.level) {
+                    std::cerr << "tlbs: walk cache level " << level << " listed twice" << std::endl;
+                    return 1;
+                }
+            }
+            if (parse_translation_cache(w, "pwc_" + level, 1ULL << page_table_shift(wc.level), &wc.cache) != 0) {
+                return 1;
+            }
+            tlb->walk_caches.push_back(wc);
+        }
+    }
+
+    if (v.HasMember("regions") && v["regions"].IsArray()) {
+        for (const auto& r : v["regions"].GetArray()) {
+            PageRegion region;
+            int index = r.HasMember("page_size") && r["page_size"].IsUint64() ? find_class(r["page_size"].GetUint64()) : -1;
+            if (!r.HasMember("start") || !parse_u64(r["start"], &region.start) ||
+                !r.HasMember("end") || !parse_u64(r["end"], &region.end) || region.end <= region.start || index == -1) {
+                std::cerr << "tlbs: regions need \"start\" < \"end\" and a configured \"page_size\"" << std::endl;
+                return 1;
+            }
+            region.page_class = index;
+            tlb->regions.push_back(region);
+        }
+    }
+
+    tlb->init();
+    for (size_t i = 1; i < tlb->regions.size(); i++) {
+        if (tlb->regions[i].start < tlb->regions[i - 1].end) {
+            std::cerr << "tlbs: regions overlap" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Parses one cache object, shared by the data hierarchy and the instruction cache
+ * Returns 0 on success, the cache is initialised and ready to use
+ */
+int parse_cache(const rapidjson::Value& c, Cache* out) {
+    Cache cache;
+
+    if (c.HasMember("name") && c["name"].IsString())
+        cache.name = c["name"].GetString();
+    if (c.HasMember("size") && c["size"].IsUint64())
+        cache.size = c["size"].GetUint64();
+    if (c.HasMember("line_size") && c["line_size"].IsUint64())
+        cache.line_size = c["line_size"].GetUint64();
+    if (c.HasMember("kind") && c["kind"].IsString()) {
+        cache.kind = parse_cache_kind(c["kind"].GetString());
+    }
+    // Skewed caches rank lines by timestamp, so they default to LRU
+    if (cache.kind == CacheKind::skewed) cache.replacement_policy = "lru";
+    if (c.HasMember("replacement_policy") && c["replacement_policy"].IsString()) {
+        cache.replacement_policy = c["replacement_policy"].GetString();
+        if (!find_policy(cache.replacement_policy)) {
+            std::cerr << "Unknown replacement policy: " << cache.replacement_policy << std::endl;
+            return 1;
+        }
+    }
+    if (c.HasMember("ways") && c["ways"].IsUint()) {
+        cache.ways = c["ways"].GetUint();
+        if (cache.ways == 0 || cache.ways > MAX_CANDIDATES) {
+            std::cerr << "Cache " << cache.name << ": ways must be between 1 and " << MAX_CANDIDATES << std::endl;
+            return 1;
+        }
+    }
+    if (c.HasMember("relocation_levels") && c["relocation_levels"].IsUint())
+        cache.skew_levels = c["relocation_levels"].GetUint();
+    if (c.HasMember("seed") && c["seed"].IsUint64())
+        cache.seed = c["seed"].GetUint64();
+    if (c.HasMember("index") && c["index"].IsString()) {
+        if (!parse_index_function(c["index"].GetString(), &cache.index_function)) {
+            std::cerr << "Unknown index function: " << c["index"].GetString() << std::endl;
+            return 1;
+        }
+    }
+    if (c.HasMember("index_matrix") && c["index_matrix"].IsArray()) {
+        for (const auto& row : c["index_matrix"].GetArray()) {
+            uint64_t mask;
+            if (!parse_u64(row, &mask)) {
+                std::cerr << "Invalid index_matrix row in cache " << cache.name << std::endl;
+                return 1;
+            }
+            cache.index_matrix.push_back(mask);
+        }
+    }
+    if (cache.kind == CacheKind::skewed && (c.HasMember("index") || c.HasMember("index_matrix"))) {
+        std::cerr << "Cache " << cache.name << ": skewed caches use their own per-way hashes, not index or "
+                  << "index_matrix" << std::endl;
+        return 1;
+    }
+
+    if (c.HasMember("write_policy") && c["write_policy"].IsString()) {
+        std::string policy = c["write_policy"].GetString();
+        if (policy != "write_back" && policy != "write_through") {
+            std::cerr << "Unknown write policy: " << policy << std::endl;
+            return 1;
+        }
+        cache.write_back = policy == "write_back";
+    }
+    if (c.HasMember("write_allocate") && c["write_allocate"].IsBool())
+        cache.write_allocate = c["write_allocate"].GetBool();
+    if (c.HasMember("hit_latency") && c["hit_latency"].IsUint64())
+        cache.hit_latency = c["hit_latency"].GetUint64();
+    if (c.HasMember("shared") && c["shared"].IsBool())
+        cache.shared = c["shared"].GetBool();
+    if (c.HasMember("sparse") && c["sparse"].IsBool())
+        cache.sparse = c["sparse"].GetBool();
+    if (c.HasMember("mshrs") && c["mshrs"].IsUint()) {
+        cache.mshrs = c["mshrs"].GetUint();
+        if (cache.mshrs == 0) {
+            std::cerr << "Cache " << cache.name << ": mshrs must be positive" << std::endl;
+            return 1;
+        }
+    }
+
+    if (c.HasMember("sector_size") && c["sector_size"].IsUint64()) {
+        cache.sector_size = c["sector_size"].GetUint64();
+        size_t s = cache.sector_size;
+        if (s == 0 || (s & (s - 1)) != 0 || s > cache.line_size || cache.line_size / s > 32) {
+            std::cerr << "Cache " << cache.name << ": sector_size must be a power of two dividing line_size "
+                      << "into at most 32 sectors" << std::endl;
+            return 1;
+        }
+    }
+
+    if (c.HasMember("victim_cache") && c["victim_cache"].IsObject()) {
+        const auto& vc = c["victim_cache"];
+        if (!vc.HasMember("entries") || !vc["entries"].IsUint() || vc["entries"].GetUint() == 0) {
+            std::cerr << "Cache " << cache.name << ": victim_cache needs a positive \"entries\"" << std::endl;
+            return 1;
+        }
+        if (cache.kind == CacheKind::skewed) {
+            std::cerr << "Cache " << cache.name << ": victim_cache is not supported on skewed caches" << std::endl;
+            return 1;
+        }
+        if (cache.sector_size && cache.sector_size != cache.line_size) {
+            std::cerr << "Cache " << cache.name << ": victim_cache does not keep sectors" << std::endl;
+            return 1;
+        }
+        cache.victim.init(vc["entries"].GetUint());
+    }
+
+    if (c.HasMember("prefetcher") && c["prefetcher"].IsObject()) {
+        const auto& pf = c["prefetcher"];
+        Prefetcher& prefetcher = cache.prefetcher;
+        std::string type = pf.HasMember("type") && pf["type"].IsString() ? pf["type"].GetString() : "";
+        if (!parse_prefetcher_kind(type, &prefetcher.kind)) {
+            std::cerr << "Cache " << cache.name << ": unknown prefetcher type \"" << type << "\"" << std::endl;
+            return 1;
+        }
+        if (pf.HasMember("degree") && pf["degree"].IsUint()) prefetcher.degree = pf["degree"].GetUint();
+        if (pf.HasMember("distance") && pf["distance"].IsUint()) prefetcher.distance = pf["distance"].GetUint();
+        if (pf.HasMember("streams") && pf["streams"].IsUint()) prefetcher.streams = pf["streams"].GetUint();
+        if (pf.HasMember("table_size") && pf["table_size"].IsUint())
+            prefetcher.table_size = pf["table_size"].GetUint();
+        if (prefetcher.streams == 0 || prefetcher.table_size == 0) {
+            std::cerr << "Cache " << cache.name << ": prefetcher streams and table_size must be positive" << std::endl;
+            return 1;
+        }
+    }
+
+    if (!init_cache(&cache)) {
+        std::cerr << "Cache " << cache.name << ": replacement policy " << cache.replacement_policy
+                  << " is not supported for this kind of cache" << std::endl;
+        return 1;
+    }
+    if (cache.prefetcher.kind != PrefetcherKind::none) {
+        cache.prefetcher.init((uint64_t)cache.num_sets * cache.lines_per_set);
+    }
+
+    // The matrix must produce exactly one bit per index bit of a power-of-two set count
+    if (cache.index_function == IndexFunction::xor_matrix &&
+        (!cache.pow2_sets || cache.index_matrix.size() != cache.index_size)) {
+        std::cerr << "Cache " << cache.name << ": xor_matrix needs a power-of-two set count and "
+                  << cache.index_size << " index_matrix rows" << std::endl;
+        return 1;
+    }
+
+    *out = std::move(cache);
+    return 0;
 }
 
 /**
@@ -51,25 +373,127 @@ int parse_config(CacheConfig* config, const std::string& filename) {
         return 1;
     }
 
+    if (doc.HasMember("inclusion") && doc["inclusion"].IsString()) {
+        std::string inclusion = doc["inclusion"].GetString();
+        if (inclusion == "inclusive") config->inclusion = Inclusion::inclusive;
+        else if (inclusion == "exclusive") config->inclusion = Inclusion::exclusive;
+        else if (inclusion == "nine") config->inclusion = Inclusion::nine;
+        else {
+            std::cerr << "Unknown inclusion mode: " << inclusion << std::endl;
+            return 1;
+        }
+    }
+
+    if (doc.HasMember("memory_latency") && doc["memory_latency"].IsUint64())
+        config->memory_latency = doc["memory_latency"].GetUint64();
+
+    if (doc.HasMember("cores") && doc["cores"].IsUint()) config->cores = doc["cores"].GetUint();
+    if (doc.HasMember("quantum") && doc["quantum"].IsUint()) config->quantum = doc["quantum"].GetUint();
+    if (config->cores == 0 || config->cores > 64 || config->quantum == 0) {
+        std::cerr << "Invalid config: cores must be 1..64 and quantum positive" << std::endl;
+        return 1;
+    }
+
+    if (doc.HasMember("timing") && doc["timing"].IsObject()) {
+        const auto& t = doc["timing"];
+        config->timing = true;
+        if (t.HasMember("issue_interval") && t["issue_interval"].IsUint64())
+            config->issue_interval = t["issue_interval"].GetUint64();
+    }
+
+    if (doc.HasMember("tlbs")) {
+        if (!doc["tlbs"].IsObject()) {
+            std::cerr << "Invalid config: \"tlbs\" must be an object" << std::endl;
+            return 1;
+        }
+        if (parse_tlbs(doc["tlbs"], &config->tlb) != 0) return 1;
+    }
+
     /* Iternates through cache configs */
     for (const auto& c : doc["caches"].GetArray()) {
         Cache cache;
-        
-        if (c.HasMember("name") && c["name"].IsString())
-            cache.name = c["name"].GetString();
-        if (c.HasMember("size") && c["size"].IsUint64())
-            cache.size = c["size"].GetUint64();
-        if (c.HasMember("line_size") && c["line_size"].IsUint64())
-            cache.line_size = c["line_size"].GetUint64();
-        if (c.HasMember("kind") && c["kind"].IsString()) {
-            cache.kind = parse_cache_kind(c["kind"].GetString());
+        if (parse_cache(c, &cache) != 0) return 1;
+        config->caches.push_back(cache);
+    }
+
+    if (config->caches.empty()) {
+        std::cerr << "Invalid config: no caches" << std::endl;
+        return 1;
+    }
+
+    // The instruction cache sits beside the first level and shares the levels below it
+    if (doc.HasMember("icache")) {
+        if (!doc["icache"].IsObject()) {
+            std::cerr << "Invalid config: icache must be an object" << std::endl;
+            return 1;
+        }
+        if (parse_cache(doc["icache"], &config->icache) != 0) return 1;
+        if (config->icache.name.empty()) config->icache.name = "L1I";
+        config->split_l1 = true;
+
+        if (config->inclusion == Inclusion::exclusive || config->cores > 1) {
+            std::cerr << "An icache needs a single-core, non-exclusive hierarchy" << std::endl;
+            return 1;
         }
-        if (c.HasMember("replacement_policy") && c["replacement_policy"].IsString()) {
-            cache.replacement_policy = parse_replacement_policy(c["replacement_policy"].GetString());
+        const Cache& ic = config->icache;
+        if (ic.prefetcher.kind != PrefetcherKind::none || ic.sector_shift != ic.offset_size) {
+            std::cerr << "The icache does not support prefetchers or sectored lines" << std::endl;
+            return 1;
         }
+    }
 
-        init_cache(&cache);
-        config->caches.push_back(cache);
+    // Coherence is kept per line of the private levels, which must be write-back and complete
+    if (config->cores > 1) {
+        bool seen_shared = false;
+        for (const auto& cache : config->caches) {
+            if (cache.line_size != config->caches[0].line_size) {
+                std::cerr << "Multi-core configs need the same line_size at every level" << std::endl;
+                return 1;
+            }
+            if (!cache.shared && seen_shared) {
+                std::cerr << "Multi-core configs list private caches before shared ones" << std::endl;
+                return 1;
+            }
+            if (!cache.shared && (!cache.write_back || !cache.write_allocate || cache.sector_shift != cache.offset_size)) {
+                std::cerr << "Private caches in multi-core configs must be write-back, write-allocate and unsectored"
+                          << std::endl;
+                return 1;
+            }
+            seen_shared |= cache.shared;
+        }
+        if (config->caches[0].shared) {
+            std::cerr << "Multi-core configs need at least one private cache" << std::endl;
+            return 1;
+        }
+    }
+
+    // A store an inclusive lower level does not allocate could still fill a level above it
+    if (config->inclusion == Inclusion::inclusive) {
+        for (size_t level = 1; level < config->caches.size(); level++) {
+            if (!config->caches[level].write_allocate) {
+                std::cerr << "Inclusive hierarchies need write-allocate caches below the first level ("
+                          << config->caches[level].name << ")" << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // Exclusive levels swap whole lines, so they have to agree on line size and write policy
+    if (config->inclusion == Inclusion::exclusive) {
+        for (const auto& cache : config->caches) {
+            if (cache.line_size != config->caches[0].line_size) {
+                std::cerr << "Exclusive hierarchies need the same line_size at every level" << std::endl;
+                return 1;
+            }
+            if (!cache.write_back || !cache.write_allocate) {
+                std::cerr << "Exclusive hierarchies need write-back, write-allocate caches" << std::endl;
+                return 1;
+            }
+            if (cache.sector_size && cache.sector_size != cache.line_size) {
+                std::cerr << "Exclusive hierarchies do not support sectored lines" << std::endl;
+                return 1;
+            }
+        }
     }
 
     return 0;
@@ -0,0 +1,173 @@
+#include "direct.hpp"
+
+namespace CacheSim {
+
+namespace {
+
+/* Records the line leaving this level, so the hierarchy can act on it */
+inline void record_direct_eviction(Cache* cache, uint64_t idx) {
+    uint8_t flags = cache->direct_flags[idx];
+    cache->evicted.valid = true;
+    cache->evicted.dirty = flags & DIRECT_DIRTY;
+    cache->evicted.prefetched = flags & DIRECT_PREFETCHED;
+    cache->evicted.addr = cache->direct_tags[idx] << cache->offset_size;
+}
+
+/* Replaces whatever set idx holds with line; cache->evicted describes the old line */
+inline void fill_direct(Cache* cache, uint64_t idx, uint64_t line, uint8_t flags) {
+    cache->evicted.valid = false;
+    if (cache->direct_tags[idx] != DIRECT_EMPTY) {
+        record_direct_eviction(cache, idx);
+        if (cache->evicted.prefetched) cache->prefetcher.unused++;
+    } else {
+        cache->valid_lines++;
+    }
+    cache->direct_tags[idx] = line;
+    cache->direct_flags[idx] = flags;
+}
+
+/* Demand hit bookkeeping, shared by lookups and repeat_hit */
+inline void hit_direct(Cache* cache, uint64_t idx, bool write) {
+    uint8_t& flags = cache->direct_flags[idx];
+    cache->hits++;
+    if (flags & DIRECT_PREFETCHED) {
+        flags &= ~DIRECT_PREFETCHED;
+        cache->prefetcher.useful++;
+    }
+    if (write) {
+        cache->write_hits++;
+        if (cache->write_back) flags |= DIRECT_DIRTY;
+    }
+}
+
+/* Demand access to set idx once the lookup result is known, mirroring access_impl */
+inline bool apply_direct(Cache* cache, uint64_t idx, uint64_t line, bool write, bool hit) {
+    if (hit) {
+        hit_direct(cache, idx, write);
+        cache->last_hit_line = line;
+        cache->last_hit_set = idx;
+        cache->last_hit_way = 0;
+        return true;
+    }
+
+    cache->last_hit_line = ~0ULL;
+    cache->misses++;
+    if (write) {
+        cache->write_misses++;
+        if (!cache->write_allocate) {
+            cache->evicted.valid = false;
+            return false;
+        }
+    }
+    cache->sector_fills++;
+    fill_direct(cache, idx, line, write && cache->write_back ? DIRECT_DIRTY : 0);
+    return false;
+}
+
+bool access_direct(Cache* cache, uint64_t addr, uint64_t, bool write, uint32_t) {
+    uint64_t idx = cache->get_index(addr);
+    uint64_t line = addr >> cache->offset_size;
+    return apply_direct(cache, idx, line, write, cache->direct_tags[idx] == line);
+}
+
+bool probe_direct(Cache* cache, uint64_t addr) {
+    return cache->direct_tags[cache->get_index(addr)] == addr >> cache->offset_size;
+}
+
+void insert_direct(Cache* cache, uint64_t addr, uint64_t, bool dirty, bool prefetched) {
+    uint64_t idx = cache->get_index(addr);
+    uint64_t line = addr >> cache->offset_size;
+
+    cache->evicted.valid = false;
+    cache->last_hit_line = ~0ULL;
+    if (cache->direct_tags[idx] == line) {
+        if (dirty) cache->direct_flags[idx] |= DIRECT_DIRTY;
+        return;
+    }
+    fill_direct(cache, idx, line, (dirty ? DIRECT_DIRTY : 0) | (prefetched ? DIRECT_PREFETCHED : 0));
+}
+
+bool invalidate_direct(Cache* cache, uint64_t addr) {
+    uint64_t idx = cache->get_index(addr);
+
+    cache->last_hit_line = ~0ULL;
+    if (cache->direct_tags[idx] != addr >> cache->offset_size) return false;
+    record_direct_eviction(cache, idx);
+    cache->direct_tags[idx] = DIRECT_EMPTY;
+    cache->direct_flags[idx] = 0;
+    cache->valid_lines--;
+    return true;
+}
+
+bool mark_dirty_direct(Cache* cache, uint64_t addr) {
+    uint64_t idx = cache->get_index(addr);
+    if (cache->direct_tags[idx] != addr >> cache->offset_size) return false;
+    cache->direct_flags[idx] |= DIRECT_DIRTY;
+    return true;
+}
+
+void repeat_hit_direct(Cache* cache, uint64_t, bool write) {
+    hit_direct(cache, cache->last_hit_set, write);
+}
+
+/* Result byte of one batched access; a hit leaves cache->evicted stale, so it only counts after a miss */
+inline uint8_t batch_result(const Cache* cache, bool hit) {
+    if (hit) return BATCH_HIT;
+    return cache->evicted.valid && cache->evicted.dirty ? BATCH_DIRTY_EVICTION : 0;
+}
+
+void init_noop(Cache*) {}
+
+constexpr EngineOps direct_engine{"direct", &init_noop, &access_direct, &probe_direct, &insert_direct,
+                                  &invalidate_direct, &mark_dirty_direct, &repeat_hit_direct};
+
+}  // anonymous namespace
+
+bool init_direct(Cache* cache) {
+    if (!find_policy(cache->replacement_policy)) return false;
+
+    cache->direct_tags.assign(cache->num_sets, DIRECT_EMPTY);
+    cache->direct_flags.assign(cache->num_sets, 0);
+    cache->engine = &direct_engine;
+    cache->access_fn = direct_engine.access;
+    return true;
+}
+
+bool uses_direct_engine(const Cache* cache) {
+    return cache->engine == &direct_engine;
+}
+
+void access_direct_batch(Cache* cache, const uint64_t* addrs, const uint8_t* writes, size_t n, uint8_t* results) {
+    typedef uint64_t u64x4 __attribute__((vector_size(32)));
+    constexpr size_t LANES = 4;
+    const uint64_t* tags = cache->direct_tags.data();
+
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        uint64_t idx[LANES];
+        u64x4 key, resident;
+        for (size_t j = 0; j < LANES; j++) {
+            idx[j] = cache->get_index(addrs[i + j]);
+            key[j] = addrs[i + j] >> cache->offset_size;
+            resident[j] = tags[idx[j]];
+        }
+        u64x4 eq = key == resident;
+
+        for (size_t j = 0; j < LANES; j++) {
+            bool hit = eq[j] != 0;
+            for (size_t k = 0; k < j; k++) {
+                if (idx[k] == idx[j]) {
+                    hit = tags[idx[j]] == key[j];
+                    break;
+                }
+            }
+            results[i + j] = batch_result(cache, apply_direct(cache, idx[j], key[j], writes[i + j], hit));
+        }
+    }
+
+    for (; i < n; i++) {
+        results[i] = batch_result(cache, access_direct(cache, addrs[i], 0, writes[i], 1));
+    }
+}
+
+}  // namespace CacheSim
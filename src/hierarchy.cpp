@@ -0,0 +1,601 @@
+#include "hierarchy.hpp"
+#include "direct.hpp"
+#include <utility>
+
+namespace CacheSim {
+
+// Host memory above which a level's sets are prefetched ahead of use
+constexpr size_t HOST_PREFETCH_BYTES = 1 << 20;
+
+Hierarchy::Hierarchy(CacheConfig config)
+    : caches(std::move(config.caches)),
+      inclusion(config.inclusion),
+      split_l1(config.split_l1),
+      icache(std::move(config.icache)),
+      tlb(std::move(config.tlb)),
+      memory_latency(config.memory_latency),
+      line_size_(caches[0].line_size) {
+    for (const auto& cache : caches) {
+        if (cache.prefetcher.kind != PrefetcherKind::none) prefetching_ = true;
+        if (cache.sector_shift != cache.offset_size) sectored_ = true;
+        if (cache.line_size != line_size_) uniform_lines_ = false;
+    }
+    const Cache& top = caches[0];
+    fast_path = top.kind != CacheKind::skewed && top.prefetcher.kind == PrefetcherKind::none &&
+                top.sector_shift == top.offset_size;
+
+    // Levels whose tags and metadata exceed the host's caches miss on nearly every lookup; sparse levels grow to
+    for (size_t level = 0; level < caches.size(); level++) {
+        const Cache& cache = caches[level];
+        if (host_footprint(&cache) > HOST_PREFETCH_BYTES || cache.sparse_sets.enabled) {
+            prefetch_levels_.push_back(level);
+        }
+    }
+
+    last_line_.assign(caches.size(), 0);
+    last_timer_.assign(caches.size(), 0);
+    instruction_hits.assign(caches.size(), 0);
+    instruction_misses.assign(caches.size(), 0);
+
+    timing.enabled = config.timing;
+    timing.issue_interval = config.issue_interval;
+    timing.memory_latency = memory_latency;
+    for (const auto& cache : caches) {
+        timing.levels.push_back(TimingModel::Level{cache.hit_latency, cache.offset_size, MshrFile{}});
+        timing.levels.back().mshr.init(cache.mshrs);
+    }
+}
+
+void Hierarchy::finish() {
+    if (timing.enabled) timing.finish();
+}
+
+/* Prefetches the sets the entry's first line maps to in every large level */
+void Hierarchy::prefetch(const TraceEntry& entry) const {
+    for (size_t level : prefetch_levels_) prefetch_set(&caches[level], entry.addr);
+}
+
+/* TLBs and walk caches are left out: page sizes or table levels the trace never reaches cannot fill */
+bool Hierarchy::full() const {
+    auto cache_full = [](const Cache& cache) { return cache.valid_lines >= cache.reachable_sets * cache.lines_per_set; };
+    for (const auto& cache : caches) {
+        if (!cache_full(cache)) return false;
+    }
+    return !split_l1 || cache_full(icache);
+}
+
+void Hierarchy::classify_misses() {
+    for (auto& cache : caches) CacheSim::classify_misses(&cache);
+    if (split_l1) CacheSim::classify_misses(&icache);
+}
+
+/* Every demand access must reach the profile, so the same-line fast path is turned off */
+void Hierarchy::profile_reuse() {
+    fast_path = false;
+    for (auto& cache : caches) CacheSim::profile_reuse(&cache);
+    if (split_l1) CacheSim::profile_reuse(&icache);
+}
+
+void Hierarchy::offset_seeds(uint64_t offset) {
+    for (Cache* cache : state_caches()) {
+        cache->seed += offset;
+        cache->rng.seed(cache->seed);
+    }
+}
+
+void Hierarchy::reset_stats() {
+    auto reset = [](Cache& cache) {
+        cache.hits = cache.misses = cache.write_hits = cache.write_misses = 0;
+        cache.writebacks = cache.relocations = cache.inclusion_victims = 0;
+        cache.sector_misses = cache.sector_fills = 0;
+        cache.way_hint_hits = cache.way_hint_misses = 0;
+        cache.victim.hits = 0;
+        cache.miss_classes.compulsory = cache.miss_classes.capacity = cache.miss_classes.conflict = 0;
+        cache.reuse.cold = 0;
+        cache.reuse.histogram.assign(cache.reuse.histogram.size(), 0);
+        Prefetcher& pf = cache.prefetcher;
+        pf.issued = pf.useful = pf.unused = pf.pollution = 0;
+    };
+
+    for (auto& cache : caches) reset(cache);
+    if (split_l1) reset(icache);
+    for (auto& pc : tlb.classes) {
+        reset(pc.l1);
+        reset(pc.l2);
+        pc.walks = 0;
+    }
+    for (auto& wc : tlb.walk_caches) reset(wc.cache);
+    tlb.walks = tlb.walk_memory_references = 0;
+
+    main_memory_accesses = main_memory_writes = main_memory_writebacks = main_memory_prefetches = 0;
+    instruction_fetches = instruction_memory_accesses = 0;
+    instruction_hits.assign(caches.size(), 0);
+    instruction_misses.assign(caches.size(), 0);
+}
+
+bool Hierarchy::timed() const {
+    if (memory_latency || (split_l1 && icache.hit_latency)) return true;
+    for (const auto& cache : caches) {
+        if (cache.hit_latency) return true;
+    }
+    return false;
+}
+
+uint64_t Hierarchy::level_cycles(size_t level) const {
+    const Cache& cache = caches[level];
+    return (cache.hits + cache.misses) * cache.hit_latency;
+}
+
+uint64_t Hierarchy::total_cycles() const {
+    uint64_t cycles = memory_cycles();
+    if (split_l1) cycles += (icache.hits + icache.misses) * icache.hit_latency;
+    for (size_t level = 0; level < caches.size(); level++) cycles += level_cycles(level);
+    return cycles;
+}
+
+double Hierarchy::amat() const {
+    uint64_t accesses = caches[0].hits + caches[0].misses;
+    if (split_l1) accesses += icache.hits + icache.misses;
+    return accesses ? (double)total_cycles() / accesses : 0.0;
+}
+
+/**
+ * Removes a line evicted from `level` from every level above it
+ * Upper levels may use smaller lines, so every upper line inside the evicted one is dropped.
+ * Returns true if any dropped copy was dirty, its data then travels with the evicted line.
+ */
+bool Hierarchy::back_invalidate(size_t level, uint64_t addr) {
+    uint64_t size = caches[level].line_size;
+    bool dirty = false;
+
+    for (size_t upper = 0; upper < level; upper++) {
+        Cache& cache = caches[upper];
+        uint64_t start = addr & ~(uint64_t)(cache.line_size - 1);
+
+        for (uint64_t a = start; a < addr + size; a += cache.line_size) {
+            if (invalidate_line(&cache, a)) {
+                cache.inclusion_victims++;
+                dirty |= cache.evicted.dirty;
+                if (cache.evicted.prefetched) cache.prefetcher.unused++;
+            }
+        }
+    }
+
+    // The L1I sits above every shared level; its lines are never dirty
+    if (split_l1) {
+        uint64_t start = addr & ~(uint64_t)(icache.line_size - 1);
+        for (uint64_t a = start; a < addr + size; a += icache.line_size) {
+            if (invalidate_line(&icache, a)) icache.inclusion_victims++;
+        }
+    }
+    return dirty;
+}
+
+/**
+ * Delivers a dirty line of `size` bytes to the first level below that holds it in write-back mode
+ * Writebacks do not allocate and leave hit/miss counters and replacement state alone
+ */
+void Hierarchy::write_back(size_t level, uint64_t addr, uint64_t size) {
+    if (write_back_range(level, addr, size)) main_memory_writebacks++;
+}
+
+/**
+ * A level with smaller lines than the data absorbs the parts it holds and passes the rest on
+ * Returns true if any part reached memory
+ */
+bool Hierarchy::write_back_range(size_t level, uint64_t addr, uint64_t size) {
+    for (; level < caches.size(); level++) {
+        Cache& cache = caches[level];
+        if (!cache.write_back) continue;
+        if (cache.line_size >= size) {
+            if (mark_dirty(&cache, addr)) return false;
+            continue;
+        }
+
+        bool reached = false;
+        for (uint64_t a = addr; a < addr + size; a += cache.line_size) {
+            if (!mark_dirty(&cache, a)) reached |= write_back_range(level + 1, a, cache.line_size);
+        }
+        return reached;
+    }
+    return true;
+}
+
+/* Acts on the line the last fill at `level` pushed out */
+template <Inclusion Mode>
+void Hierarchy::handle_eviction(size_t level) {
+    Eviction ev = caches[level].evicted;
+    bool dirty = ev.dirty;
+
+    if (Mode == Inclusion::inclusive && level > 0) {
+        dirty |= back_invalidate(level, ev.addr);
+    }
+    if (dirty) {
+        caches[level].writebacks++;
+        write_back(level + 1, ev.addr, caches[level].line_size);
+    }
+}
+
+/**
+ * Moves a line leaving `level` down an exclusive hierarchy until a level has room for it
+ * The last level's victim leaves the hierarchy, written back to memory if dirty
+ */
+void Hierarchy::spill(size_t level, Eviction ev, uint64_t timer) {
+    level++;
+    for (; level < caches.size() && ev.valid; level++) {
+        if (ev.dirty) caches[level - 1].writebacks++;
+        insert_line(&caches[level], ev.addr, timer, ev.dirty);
+        caches[level].prefetcher.refill(ev.addr >> caches[level].offset_size);
+        ev = caches[level].evicted;
+    }
+    if (ev.valid && ev.dirty) {
+        caches[level - 1].writebacks++;
+        main_memory_writebacks++;
+    }
+}
+
+/**
+ * Reports a demand access at `level` to its prefetcher and queues the lines it asks for
+ * A demand miss to a line that a prefetch fill pushed out counts as pollution.
+ */
+void Hierarchy::observe_prefetch(size_t level, uint64_t addr, uint64_t pc, bool hit, uint64_t useful_before) {
+    Cache& cache = caches[level];
+    Prefetcher& pf = cache.prefetcher;
+    uint64_t line = addr >> cache.offset_size;
+
+    if (!hit && pf.refill(line)) pf.pollution++;
+
+    pf.observe(line, pc, hit, pf.useful != useful_before, &prefetch_lines_);
+    for (uint64_t l : prefetch_lines_) prefetch_queue_.push_back(PrefetchRequest{level, l << cache.offset_size});
+    prefetch_lines_.clear();
+}
+
+/**
+ * Brings a line into `level` on behalf of its prefetcher
+ * The data comes from the first lower level holding it, otherwise from memory. The fill obeys the
+ * inclusion policy: inclusive levels below receive the line first, an exclusive hierarchy moves it
+ * up and spills the displaced line down. Prefetch fills never touch hit/miss counters.
+ */
+template <Inclusion Mode>
+void Hierarchy::prefetch_fill(size_t level, uint64_t addr, uint64_t timer) {
+    Cache& cache = caches[level];
+    if (probe_cache(&cache, addr)) {
+        // Not prefetched again, but a partially valid sectored line is completed
+        if (sectored_) insert_line(&cache, addr, timer);
+        return;
+    }
+
+    // An exclusive hierarchy may already hold the line above a lower level's prefetcher
+    if (Mode == Inclusion::exclusive) {
+        for (size_t upper = 0; upper < level; upper++) {
+            if (probe_cache(&caches[upper], addr)) return;
+        }
+    }
+
+    bool found = false;
+    bool dirty = false;
+    for (size_t lower = level + 1; lower < caches.size() && !found; lower++) {
+        if (!probe_cache(&caches[lower], addr)) continue;
+        found = true;
+        if (Mode == Inclusion::exclusive) {
+            invalidate_line(&caches[lower], addr);
+            dirty = caches[lower].evicted.dirty;
+        }
+    }
+    if (!found) main_memory_prefetches++;
+
+    if (Mode == Inclusion::inclusive) {
+        for (size_t lower = caches.size() - 1; lower > level; lower--) {
+            if (probe_cache(&caches[lower], addr)) {
+                if (sectored_) insert_line(&caches[lower], addr, timer);  // Completes a partial line
+                continue;
+            }
+            insert_line(&caches[lower], addr, timer);
+            caches[lower].prefetcher.refill(addr >> caches[lower].offset_size);
+            if (caches[lower].evicted.valid) handle_eviction<Mode>(lower);
+        }
+    }
+
+    Prefetcher& pf = cache.prefetcher;
+    pf.issued++;
+    pf.refill(addr >> cache.offset_size);
+    insert_line(&cache, addr, timer, dirty, true);
+
+    Eviction ev = cache.evicted;
+    if (!ev.valid) return;
+    if (!ev.prefetched) pf.displace(ev.addr >> cache.offset_size);
+
+    if (Mode == Inclusion::exclusive) spill(level, ev, timer);
+    else handle_eviction<Mode>(level);
+}
+
+template <Inclusion Mode>
+void Hierarchy::issue_prefetches(uint64_t timer) {
+    for (const auto& request : prefetch_queue_) {
+        prefetch_fill<Mode>(request.level, request.addr, timer);
+    }
+    prefetch_queue_.clear();
+}
+
+/**
+ * One line-sized access through the hierarchy
+ *
+ * nine:      probe in order and fill every level that missed
+ * inclusive: as nine, but a line evicted from a lower level is also dropped from the levels above
+ * exclusive: only the first level is filled; a hit below moves the line up, and each level's
+ *            victim moves down one level (the last level's victim leaves the hierarchy)
+ *
+ * Loads (and stores that allocate in a write-back level) continue down as line fetches. Stores
+ * continue down as stores past write-through levels and past levels that do not allocate.
+ * Levels with a prefetcher report each demand access to it; exclusive lower levels report their probes.
+ *
+ * [lo, hi) is the byte range the access needs. A sectored level checks and fills only the sectors
+ * covering it; after a miss the range widens to that level's fill unit (sector or line), which is
+ * what the next level has to supply.
+ */
+template <Inclusion Mode>
+void Hierarchy::access_line(uint64_t addr, uint64_t lo, uint64_t hi, uint64_t timer, bool write, uint64_t pc) {
+    const size_t n = caches.size();
+
+    if (Mode != Inclusion::exclusive) {
+        bool fetch = false;  // Some level above still needs the line's data
+        depth_ = n;
+
+        for (size_t level = 0; level < n; level++) {
+            Cache& cache = caches[level];
+            uint64_t useful = cache.prefetcher.useful;
+            uint32_t sectors = sectored_ ? cache.sector_mask(lo, hi) : 1;
+            bool hit = access_cache(&cache, addr, timer, write, sectors);
+            if (cache.prefetcher.kind != PrefetcherKind::none) observe_prefetch(level, addr, pc, hit, useful);
+
+            if (hit) {
+                if (depth_ == n) depth_ = level;
+                if (!write || cache.write_back) return;
+                fetch = false;  // Write-through hit: data is here, the store carries on
+                continue;
+            }
+
+            if (cache.evicted.valid) handle_eviction<Mode>(level);
+
+            if (sectored_) {
+                uint64_t unit = (uint64_t)1 << cache.sector_shift;
+                lo &= ~(unit - 1);
+                hi = (hi + unit - 1) & ~(unit - 1);
+            }
+
+            if (!write || cache.write_allocate) fetch = true;
+            if (write && cache.write_back && cache.write_allocate) write = false;
+        }
+
+        // If not found in any cache, count as main memory access
+        if (fetch) main_memory_accesses++;
+        if (write) main_memory_writes++;
+        return;
+    }
+
+    // Exclusive: the first level is a normal demand access
+    Cache& top = caches[0];
+    uint64_t useful = top.prefetcher.useful;
+    bool hit = access_cache(&top, addr, timer, write);
+    if (top.prefetcher.kind != PrefetcherKind::none) observe_prefetch(0, addr, pc, hit, useful);
+    depth_ = 0;
+    if (hit) return;
+    Eviction victim = top.evicted;
+
+    // Lower levels are searched without filling; a hit moves the line (and its dirty state) up
+    bool found = false;
+    for (size_t level = 1; level < n && !found; level++) {
+        Cache& cache = caches[level];
+        useful = cache.prefetcher.useful;
+        if (lookup_line(&cache, addr)) {
+            invalidate_line(&cache, addr);
+            if (cache.evicted.dirty) mark_dirty(&top, addr);
+            if (cache.evicted.prefetched) cache.prefetcher.useful++;
+            depth_ = level;
+            found = true;
+        }
+        if (cache.prefetcher.kind != PrefetcherKind::none) observe_prefetch(level, addr, pc, found, useful);
+    }
+    if (!found) {
+        depth_ = n;
+        main_memory_accesses++;
+    }
+
+    // The first level's victim cascades down until a level has room for it
+    spill(0, victim, timer);
+}
+
+/**
+ * access_line for hierarchies whose levels differ in line size (nine and inclusive only)
+ * Serves [lo, hi) at `level` one line of that level at a time; a miss requests its fill unit from
+ * the level below, at that level's own granularity. A line already fetched at a level by the same
+ * trace entry is not fetched again, so a larger lower line is looked up and filled once even when
+ * several upper lines miss into it. Stores are always passed on: each carries its own bytes.
+ */
+template <Inclusion Mode>
+void Hierarchy::access_range(size_t level, uint64_t lo, uint64_t hi, uint64_t timer, bool write, uint64_t pc,
+                             bool fetch) {
+    if (level == caches.size()) {
+        if (fetch) main_memory_accesses++;
+        if (write) main_memory_writes++;
+        return;
+    }
+
+    Cache& cache = caches[level];
+    const uint64_t size = cache.line_size;
+
+    for (uint64_t addr = lo & ~(size - 1); addr < hi; addr += size) {
+        if (!write) {
+            if (last_timer_[level] == timer && last_line_[level] == addr) continue;
+            last_timer_[level] = timer;
+            last_line_[level] = addr;
+        }
+
+        uint64_t part_lo = addr > lo ? addr : lo;
+        uint64_t part_hi = addr + size < hi ? addr + size : hi;
+
+        uint64_t useful = cache.prefetcher.useful;
+        uint32_t sectors = sectored_ ? cache.sector_mask(part_lo, part_hi) : 1;
+        bool hit = access_cache(&cache, addr, timer, write, sectors);
+        if (cache.prefetcher.kind != PrefetcherKind::none) observe_prefetch(level, addr, pc, hit, useful);
+
+        if (hit) {
+            if (depth_ == caches.size()) depth_ = level;
+            // Write-through hit: data is here, the store carries on
+            if (write && !cache.write_back) access_range<Mode>(level + 1, part_lo, part_hi, timer, true, pc, false);
+            continue;
+        }
+
+        if (cache.evicted.valid) handle_eviction<Mode>(level);
+
+        bool fill = fetch || !write || cache.write_allocate;
+        bool store = write && !(cache.write_back && cache.write_allocate);
+
+        // A fill needs this level's fill unit from below, a passing store only its own bytes
+        uint64_t unit = fill ? (uint64_t)1 << cache.sector_shift : 1;
+        uint64_t next_lo = part_lo & ~(unit - 1);
+        uint64_t next_hi = (part_hi + unit - 1) & ~(unit - 1);
+        access_range<Mode>(level + 1, next_lo, next_hi, timer, store, pc, fill);
+    }
+}
+
+/**
+ * Looks up the L1I line holding `pc`, fetching it through the shared levels on a miss
+ * Runs before the entry's data access. The per-level dedup of access_range is cleared afterwards,
+ * so a data access to the same lower line in this entry is still looked up.
+ */
+template <Inclusion Mode>
+void Hierarchy::fetch_instruction(uint64_t pc, uint64_t timer) {
+    uint64_t addr = pc & ~(uint64_t)(icache.line_size - 1);
+    if (addr == last_fetch_line_) return;
+    last_fetch_line_ = addr;
+
+    instruction_fetches++;
+    if (access_cache(&icache, addr, timer)) return;
+
+    // Instruction lines are clean, so an L1I victim needs no writeback
+    const size_t n = caches.size();
+    uint64_t memory_before = main_memory_accesses;
+    for (size_t level = 1; level < n; level++) {
+        instruction_hits[level] -= caches[level].hits;
+        instruction_misses[level] -= caches[level].misses;
+    }
+
+    depth_ = n;
+    access_range<Mode>(1, addr, addr + icache.line_size, timer, false, pc, true);
+
+    for (size_t level = 1; level < n; level++) {
+        instruction_hits[level] += caches[level].hits;
+        instruction_misses[level] += caches[level].misses;
+        last_timer_[level] = ~0ULL;
+    }
+    instruction_memory_accesses += main_memory_accesses - memory_before;
+}
+
+/**
+ * Runs a single trace entry through the TLBs (if configured) and the cache hierarchy
+ * Splits the access into cache lines of the first level
+ */
+void Hierarchy::access(const TraceEntry& entry, uint64_t timer) {
+    if (tlb.enabled()) tlb.translate(entry.addr, entry.size, timer);
+    if (timing.enabled) timing.next_entry();
+
+    if (split_l1) {
+        if (inclusion == Inclusion::inclusive) fetch_instruction<Inclusion::inclusive>(entry.pc, timer);
+        else fetch_instruction<Inclusion::nine>(entry.pc, timer);
+        if (!prefetch_queue_.empty()) {
+            if (inclusion == Inclusion::inclusive) issue_prefetches<Inclusion::inclusive>(timer);
+            else issue_prefetches<Inclusion::nine>(timer);
+        }
+    }
+
+    // Calculate the range of cache lines affected by this memory access
+    uint64_t start_line = entry.addr / line_size_;
+    uint64_t end_line = (entry.addr + entry.size - 1) / line_size_;
+    uint64_t end = entry.addr + entry.size;
+    bool write = entry.is_write();
+
+    // A repeat of the last first-level hit that ends there: no lower level or prefetcher is involved
+    if (fast_path && start_line == end_line && (!write || caches[0].write_back) &&
+        repeat_hit(&caches[0], entry.addr, timer, write)) {
+        if (timing.enabled) timing.access(start_line * line_size_, 0);
+        return;
+    }
+
+    // For each cache line in the access range, with the part of the access inside it
+    for (uint64_t line = start_line; line <= end_line; line++) {
+        uint64_t addr = line * line_size_;
+        uint64_t lo = addr > entry.addr ? addr : entry.addr;
+        uint64_t hi = addr + line_size_ < end ? addr + line_size_ : end;
+
+        switch (inclusion) {
+            case Inclusion::nine:
+                if (uniform_lines_) {
+                    access_line<Inclusion::nine>(addr, lo, hi, timer, write, entry.pc);
+                } else {
+                    depth_ = caches.size();
+                    access_range<Inclusion::nine>(0, lo, hi, timer, write, entry.pc, false);
+                }
+                if (!prefetch_queue_.empty()) issue_prefetches<Inclusion::nine>(timer);
+                break;
+            case Inclusion::inclusive:
+                if (uniform_lines_) {
+                    access_line<Inclusion::inclusive>(addr, lo, hi, timer, write, entry.pc);
+                } else {
+                    depth_ = caches.size();
+                    access_range<Inclusion::inclusive>(0, lo, hi, timer, write, entry.pc, false);
+                }
+                if (!prefetch_queue_.empty()) issue_prefetches<Inclusion::inclusive>(timer);
+                break;
+            case Inclusion::exclusive:
+                access_line<Inclusion::exclusive>(addr, lo, hi, timer, write, entry.pc);
+                if (!prefetch_queue_.empty()) issue_prefetches<Inclusion::exclusive>(timer);
+                break;
+        }
+        if (timing.enabled) timing.access(addr, depth_);
+    }
+}
+
+bool Hierarchy::batchable() const {
+    const Cache& top = caches[0];
+    return caches.size() == 1 && uses_direct_engine(&top) && top.access_fn == top.engine->access &&
+           top.prefetcher.kind == PrefetcherKind::none && !tlb.enabled() && !timing.enabled && !split_l1;
+}
+
+/**
+ * Splits the entries into lines and runs them through access_direct_batch, then applies what
+ * access_line does below a single level: fetches, passing stores and writebacks go to memory
+ */
+void Hierarchy::access_batch(const TraceEntry* entries, size_t n) {
+    Cache& cache = caches[0];
+    batch_addrs_.clear();
+    batch_writes_.clear();
+
+    for (size_t i = 0; i < n; i++) {
+        uint64_t start_line = entries[i].addr / line_size_;
+        uint64_t end_line = (entries[i].addr + entries[i].size - 1) / line_size_;
+        for (uint64_t line = start_line; line <= end_line; line++) {
+            batch_addrs_.push_back(line * line_size_);
+            batch_writes_.push_back(entries[i].is_write());
+        }
+    }
+    batch_results_.resize(batch_addrs_.size());
+    access_direct_batch(&cache, batch_addrs_.data(), batch_writes_.data(), batch_addrs_.size(),
+                        batch_results_.data());
+
+    for (size_t k = 0; k < batch_results_.size(); k++) {
+        bool write = batch_writes_[k];
+        if (batch_results_[k] & BATCH_HIT) {
+            if (write && !cache.write_back) main_memory_writes++;
+            continue;
+        }
+        if (batch_results_[k] & BATCH_DIRTY_EVICTION) {
+            cache.writebacks++;
+            main_memory_writebacks++;
+        }
+        if (!write || cache.write_allocate) main_memory_accesses++;
+        if (write && !(cache.write_back && cache.write_allocate)) main_memory_writes++;
+    }
+}
+
+}  // namespace CacheSim
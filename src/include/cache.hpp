@@ -7,6 +7,13 @@
 #include <string>
 #include <optional>
 #include <unordered_map>
+#include "rng.hpp"
+#include "index.hpp"
+#include "victim.hpp"
+#include "prefetch.hpp"
+#include "sparse.hpp"
+#include "classify.hpp"
+#include "reuse.hpp"
 
 namespace CacheSim {
 
@@ -36,68 +43,203 @@ private:
 struct CacheLine {
     uint64_t tag = 0;
     bool valid = false;
+    bool dirty = false;         // Written since it was filled (write-back caches only)
+    bool prefetched = false;    // Filled by the prefetcher and not yet used by a demand access
+    uint32_t sectors = 0;       // Valid sectors, bit i for sector i (a single bit when unsectored)
     uint64_t last_access = 0;   // For LRU: timestamp of last access
     uint64_t access_count = 0;  // For LFU: number of accesses
-
-    int32_t prev = -1;
-    int32_t next = -1;
 };
 
 
-enum class CacheKind { direct, full, _2way, _4way, _8way };
-enum class ReplacementPolicy { rr, lru, lfu };
+enum class CacheKind { direct, full, _2way, _4way, _8way, skewed };
+
+struct Cache;
+
+// Per-policy access routine, one template instantiation per replacement policy
+// sectors is the mask of sectors the access needs within the line
+using AccessFn = bool (*)(Cache* cache, uint64_t addr, uint64_t timer, bool write, uint32_t sectors);
+
+/**
+ * Engine entry points for one replacement policy (or cache organisation)
+ * access is the demand path; the rest serve the hierarchy and never touch hit/miss counters
+ */
+struct EngineOps {
+    const char* name;
+    void (*init)(Cache* cache);
+    AccessFn access;
+    bool (*probe)(Cache* cache, uint64_t addr);
+    void (*insert)(Cache* cache, uint64_t addr, uint64_t timer, bool dirty, bool prefetched);
+    bool (*invalidate)(Cache* cache, uint64_t addr);
+    bool (*mark_dirty)(Cache* cache, uint64_t addr);
+    void (*repeat_hit)(Cache* cache, uint64_t timer, bool write);  // Hit on the recorded last-hit line
+};
+
+// Line pushed out of a level (array and victim buffer) by its last fill or invalidation
+struct Eviction {
+    bool valid = false;
+    bool dirty = false;
+    bool prefetched = false;  // Prefetched and never used
+    uint64_t addr = 0;  // Byte address of the start of the line
+};
 
 // Cache configuration and state
 struct Cache {
     // Configuration
     std::string name;
-    size_t size;
-    size_t line_size;
-    CacheKind kind; 
-    ReplacementPolicy replacement_policy;
+    size_t size = 0;
+    size_t line_size = 0;
+    size_t sector_size = 0;       // Fill granularity within a line, 0 (or line_size) for unsectored lines
+    CacheKind kind = CacheKind::direct;
+    std::string replacement_policy = "rr";
+    uint64_t seed = 0;  // Seed for random replacement
+    unsigned int ways = 4;        // Associativity of skewed caches
+    unsigned int skew_levels = 1; // zcache relocation depth, 1 for a plain skewed cache
+    IndexFunction index_function = IndexFunction::bit_select;
+    std::vector<uint64_t> index_matrix;  // xor_matrix rows, row i produces index bit i
+    bool write_back = true;       // Otherwise write-through: writes are passed to the next level
+    bool write_allocate = true;   // Otherwise write misses are passed on without filling
+    uint64_t hit_latency = 0;     // Cycles per lookup, for the additive timing model
+    unsigned int mshrs = 8;       // Outstanding misses in timing mode
+    bool shared = false;          // Multi-core: one instance shared by all cores, otherwise one per core
+    std::optional<bool> sparse;   // Force the sparse set store on or off, otherwise chosen by size
 
     // Derived metadata
-    unsigned int num_sets;
-    unsigned int lines_per_set;
-    unsigned int tag_size;
-    unsigned int index_size;
-    unsigned int offset_size;
+    unsigned int num_sets = 0;
+    unsigned int lines_per_set = 0;
+    unsigned int tag_size = 0;
+    unsigned int index_size = 0;
+    unsigned int offset_size = 0;
+    unsigned int sector_shift = 0;   // log2(sector_size), equal to offset_size when unsectored
+    uint32_t full_sectors = 0;       // Sector mask of a complete line
+    unsigned int tag_shift = 0;      // Tags keep the whole line address unless indexing is plain bit selection
+    bool pow2_sets = false;          // Index can be reduced with a mask
+    uint64_t index_mask = 0;
+    unsigned int fold_bits = 0;      // Width the xor_fold hash is folded to
+    FastMod set_mod;             // Multiply-shift reduction for non-power-of-two (or prime) set counts
+    uint64_t reachable_sets = 0;     // Sets the index function can produce, fewer than num_sets for some
 
     // Runtime state
     uint64_t hits = 0;
     uint64_t misses = 0;
+    uint64_t write_hits = 0;   // Subsets of hits and misses caused by stores
+    uint64_t write_misses = 0;
+    uint64_t writebacks = 0;   // Dirty lines sent to the next level or memory
+    uint64_t relocations = 0;  // Lines moved by zcache replacement
+    uint64_t inclusion_victims = 0;  // Lines dropped because a lower inclusive level evicted them
+    uint64_t sector_misses = 0;  // Subset of misses where the tag hit but a needed sector was absent
+    uint64_t sector_fills = 0;   // Sectors fetched by demand misses
+    uint64_t way_hint_hits = 0;    // Demand hits found in the set's predicted (MRU) way
+    uint64_t way_hint_misses = 0;  // Demand hits found in another way
+    uint64_t valid_lines = 0;      // Lines of the main array holding data, full at num_sets * lines_per_set
+    Eviction evicted;
     std::vector<CacheLine> storage;
-    std::vector<uint32_t> rr_counters;  // Round-robin counters per set
+    std::vector<uint64_t> direct_tags;  // Direct-mapped engine: line address per set, replaces storage
+    std::vector<uint8_t> direct_flags;
+    Rng rng;                            // Random replacement generator
 
-    /** 
-     * LRU Doubly linked list 
-     * Allows for O(1) updates for lru tracking
-     * Most recently used lines at the head, least recently used at the tail
-     * On every access, accessed line is moved to the head
+    /**
+     * Replacement policy metadata, laid out by the policy itself
+     * line_meta holds one Policy::LineState per line, set_meta one Policy::SetState per set
      */
-    std::vector<int32_t> lru_head;
-    std::vector<int32_t> lru_tail;
+    const EngineOps* engine = nullptr;
+    AccessFn access_fn = nullptr;
+    std::vector<unsigned char> line_meta;
+    std::vector<unsigned char> set_meta;
+
+    /**
+     * Line, set and way of the last demand access that hit the main array, ~0 for none
+     * Cleared by misses, inserts and invalidations, so a recorded line is always resident
+     */
+    uint64_t last_hit_line = ~0ULL;
+    uint64_t last_hit_set = 0;
+    int32_t last_hit_way = 0;
+
+    // Per set, the way of the last hit or fill; checked first by lookups by set-associative caches
+    bool way_hinting = false;
+    std::vector<uint32_t> way_hints;
 
-    // Min-Heap LFU tracking
-    // lfu_heaps stores the cache line indices (0 to lines_per_set - 1)
-    std::vector<int32_t> lfu_heaps; 
-    // heap_pos maps a cache line index to its current position in the heap
-    std::vector<int32_t> heap_pos;
+    // Replaces storage, the policy metadata and way_hints when enabled
+    SparseSets sparse_sets;
 
     // Hash map, used for fully associative tag matching
     std::vector<std::unordered_map<uint64_t, int32_t>> tag_maps;
 
+    // Optional victim buffer, disabled when entries is 0
+    VictimCache victim;
+
+    // Optional prefetcher, driven by the hierarchy; kind none disables it
+    Prefetcher prefetcher;
+
+    // Optional compulsory/capacity/conflict split of misses, see classify_misses
+    MissClassifier miss_classes;
+
+    // Optional stack distance histogram, see profile_reuse
+    ReuseProfile reuse;
+
     // Methods
     Span<CacheLine> get_set(unsigned int index);
     uint64_t get_tag(uint64_t addr) const;
     uint64_t get_index(uint64_t addr) const;
+    uint64_t line_of(uint64_t tag, uint64_t index) const;
+    uint32_t sector_mask(uint64_t lo, uint64_t hi) const;
 };
 
-// Initialise cache derived values
-void init_cache(Cache* cache);
+// Look up a replacement policy by its config name, nullptr if unknown
+const EngineOps* find_policy(const std::string& name);
+
+// Initialise cache derived values, returns false if the configuration is unsupported
+bool init_cache(Cache* cache);
+
+// Host memory holding the cache's tags and replacement metadata, in bytes
+size_t host_footprint(const Cache* cache);
+
+// Issues host prefetches for the tags and metadata of the set addr maps to; simulated state is untouched
+void prefetch_set(const Cache* cache, uint64_t addr);
+
+// Routes demand accesses through the enabled analyses (miss classes, reuse) after the engine's lookup
+void observe_accesses(Cache* cache);
+
+/**
+ * Demand lookup that never fills, for the levels below the first of an exclusive hierarchy
+ * Counts the hit or miss and feeds the analyses like access_cache, but leaves the line where it is
+ * and the replacement state untouched; the hierarchy moves a hit line up itself.
+ */
+bool lookup_line(Cache* cache, uint64_t addr);
 
 // Access cache, returns true on hit
-bool access_cache(Cache* cache, uint64_t addr, uint64_t timer);
+inline bool access_cache(Cache* cache, uint64_t addr, uint64_t timer, bool write = false, uint32_t sectors = 1) {
+    return cache->access_fn(cache, addr, timer, write, sectors);
+}
+
+/**
+ * Demand hit on the line the last access hit, in O(1) without a lookup
+ * Returns false and does nothing if addr is in another line
+ */
+inline bool repeat_hit(Cache* cache, uint64_t addr, uint64_t timer, bool write = false) {
+    if ((addr >> cache->offset_size) != cache->last_hit_line) return false;
+    cache->engine->repeat_hit(cache, timer, write);
+    return true;
+}
+
+// Check whether a line is resident, without side effects
+inline bool probe_cache(Cache* cache, uint64_t addr) {
+    return cache->engine->probe(cache, addr);
+}
+
+// Place a line handed over by another level (or a prefetch); cache->evicted reports what it displaced
+inline void insert_line(Cache* cache, uint64_t addr, uint64_t timer, bool dirty = false, bool prefetched = false) {
+    cache->engine->insert(cache, addr, timer, dirty, prefetched);
+}
+
+// Remove a line if present, returns true if it was resident; cache->evicted describes it
+inline bool invalidate_line(Cache* cache, uint64_t addr) {
+    return cache->engine->invalidate(cache, addr);
+}
+
+// Absorb a writeback into a resident line, returns false if the line is not here
+inline bool mark_dirty(Cache* cache, uint64_t addr) {
+    return cache->engine->mark_dirty(cache, addr);
+}
 
 }  // namespace CacheSim
 
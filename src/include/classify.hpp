@@ -0,0 +1,70 @@
+#ifndef CLASSIFY_HPP
+#define CLASSIFY_HPP
+
+#include "line_table.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace CacheSim {
+
+struct Cache;
+
+/**
+ * Fully associative LRU cache of line addresses, O(1) per access
+ * Lines form a doubly linked recency list over slot arrays; a LineTable maps each line to its slot.
+ * Slots are added as the cache fills, so memory follows the lines seen up to the capacity.
+ */
+class ShadowLru {
+public:
+    void init(uint64_t capacity);
+
+    // Returns true if line was resident; either way it becomes the most recently used
+    bool access(uint64_t line);
+
+private:
+    static constexpr uint32_t NIL = ~0u;
+
+    uint64_t capacity_ = 0;
+    std::vector<uint64_t> lines_;
+    std::vector<uint32_t> prev_;  // Towards the most recently used end
+    std::vector<uint32_t> next_;
+    uint32_t head_ = NIL;  // Most recently used
+    uint32_t tail_ = NIL;  // Least recently used
+    LineTable<uint32_t> slots_;
+
+    void unlink(uint32_t slot);
+    void push_front(uint32_t slot);
+};
+
+/**
+ * Three-C miss classification of a cache's demand accesses
+ * A miss is compulsory on the first access to its line, a capacity miss if a fully associative
+ * LRU cache of the same number of lines would also miss, and a conflict miss otherwise.
+ * First touches are tracked in one 64-bit mask per 64 consecutive lines.
+ */
+struct MissClassifier {
+    uint64_t compulsory = 0;
+    uint64_t capacity = 0;
+    uint64_t conflict = 0;
+
+    bool enabled() const { return enabled_; }
+    void init(uint64_t lines);
+
+    // One demand access to line; miss tells whether the real cache missed
+    void observe(uint64_t line, bool miss);
+
+private:
+    bool enabled_ = false;
+    ShadowLru shadow_;
+    LineTable<uint64_t> seen_;
+};
+
+/**
+ * Starts classifying the cache's misses, see observe_accesses
+ * repeat_hit may bypass it: a repeat hit is on the line accessed last, already the shadow's MRU line.
+ */
+void classify_misses(Cache* cache);
+
+}  // namespace CacheSim
+
+#endif
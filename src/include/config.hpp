@@ -2,13 +2,30 @@
 #define CONFIG_HPP
 
 #include "cache.hpp"
+#include "tlb.hpp"
 #include <vector>
 #include <string>
 
 namespace CacheSim {
 
+// How the contents of successive levels relate to each other
+enum class Inclusion {
+    nine,       // Non-inclusive non-exclusive: fill every level that missed, no back-invalidation
+    inclusive,  // Every line of a level is also in the levels below it
+    exclusive   // A line lives in exactly one level, lines move down on eviction
+};
+
 struct CacheConfig {
     std::vector<Cache> caches;
+    bool split_l1 = false;  // An "icache" section adds an L1I fed from the pc field
+    Cache icache;
+    Inclusion inclusion = Inclusion::nine;
+    Tlb tlb;  // Disabled unless the config has a "tlbs" section
+    uint64_t memory_latency = 0;  // Cycles per line fetched from main memory
+    bool timing = false;          // Non-blocking MSHR timing mode
+    uint64_t issue_interval = 1;  // Cycles between trace entries in timing mode
+    unsigned int cores = 1;       // More than one runs the multi-core model, one trace per core
+    unsigned int quantum = 1;     // Trace entries a core runs before the next core's turn
 };
 
 // Parse cache configuration from JSON file
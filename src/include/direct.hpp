@@ -0,0 +1,40 @@
+#ifndef DIRECT_HPP
+#define DIRECT_HPP
+
+#include "cache.hpp"
+
+namespace CacheSim {
+
+/**
+ * Direct-mapped engine
+ * Keeps one packed line address per set (DIRECT_EMPTY when invalid) and a flag byte, instead of
+ * a CacheLine and policy metadata, so a lookup is a single compare. Used for direct-mapped caches
+ * without sectors or a victim buffer; the replacement policy has no effect with one way.
+ */
+
+constexpr uint64_t DIRECT_EMPTY = ~0ULL;  // No line address reaches this value
+
+// Flag bits of direct_flags
+constexpr uint8_t DIRECT_DIRTY = 1;
+constexpr uint8_t DIRECT_PREFETCHED = 2;
+
+// Result bits of access_direct_batch, one byte per access
+constexpr uint8_t BATCH_HIT = 1;
+constexpr uint8_t BATCH_DIRTY_EVICTION = 2;  // The fill pushed out a dirty line
+
+// Sets up a direct-mapped cache, returns false for an unknown replacement policy
+bool init_direct(Cache* cache);
+
+// True if the cache runs the packed direct-mapped engine
+bool uses_direct_engine(const Cache* cache);
+
+/**
+ * n demand accesses in order, with the same effect as n access_cache calls
+ * Set indices and resident tags are gathered four at a time and compared as one vector; a lane
+ * whose set an earlier lane of its group touched is rechecked after that lane is applied.
+ */
+void access_direct_batch(Cache* cache, const uint64_t* addrs, const uint8_t* writes, size_t n, uint8_t* results);
+
+}  // namespace CacheSim
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef HIERARCHY_HPP
+#define HIERARCHY_HPP
+
+#include "cache.hpp"
+#include "config.hpp"
+#include "trace.hpp"
+#include "timing.hpp"
+#include <string>
+#include <vector>
+
+namespace CacheSim {
+
+/**
+ * A chain of caches in front of main memory
+ * Owns the caches and implements the inclusion and write policies between them. The inclusion
+ * policy is fixed at construction, so each access takes one switch and then runs a loop
+ * specialised for that mode.
+ */
+class Hierarchy {
+public:
+    explicit Hierarchy(CacheConfig config);
+
+    // Runs one trace entry, split into first-level lines
+    void access(const TraceEntry& entry, uint64_t timer);
+
+    /**
+     * Host-side group prefetching: callers run prefetch() on the next few entries before
+     * accessing them, so the sets of large levels are in host cache when the lookups reach them
+     */
+    bool host_prefetching() const { return !prefetch_levels_.empty(); }
+    void prefetch(const TraceEntry& entry) const;
+
+    // Splits the misses of every data level and the L1I into compulsory, capacity and conflict misses
+    void classify_misses();
+
+    // Records LRU stack distance histograms of every data level and the L1I
+    void profile_reuse();
+
+    // True for a single direct-mapped level without a prefetcher, TLBs, L1I, timing or access analyses
+    bool batchable() const;
+
+    // Runs n trace entries with the same effect as n access() calls, on a batchable hierarchy
+    void access_batch(const TraceEntry* entries, size_t n);
+
+    std::vector<Cache> caches;
+    Inclusion inclusion;
+
+    /**
+     * Optional L1 instruction cache beside caches[0]
+     * Each entry's pc is fetched before its data access; consecutive fetches from the same line
+     * count once. L1I misses go to caches[1] onwards, so the levels below are shared.
+     */
+    bool split_l1 = false;
+    Cache icache;
+    uint64_t instruction_fetches = 0;             // L1I lookups after same-line dedup
+    std::vector<uint64_t> instruction_hits;       // Per level, hits and misses caused by L1I misses
+    std::vector<uint64_t> instruction_misses;
+    uint64_t instruction_memory_accesses = 0;     // Line fetches from memory for L1I misses
+
+    Tlb tlb;
+    uint64_t main_memory_accesses = 0;    // Line fetches from memory
+    uint64_t main_memory_writes = 0;      // Stores written through or not allocated by the last level
+    uint64_t main_memory_writebacks = 0;  // Dirty lines evicted to memory
+    uint64_t main_memory_prefetches = 0;  // Line fetches from memory issued by prefetchers
+
+    /**
+     * Entries inside the line the first level hit last skip the lookup (see repeat_hit)
+     * Off when the first level has a prefetcher or sectors, which must see every access in full
+     */
+    bool fast_path = false;
+
+    // True if any level has a prefetcher
+    bool prefetching() const { return prefetching_; }
+
+    /**
+     * Additive timing model, derived from the counters so it costs nothing per access
+     * Every lookup at a level costs its hit latency and every line fetched from memory costs the
+     * memory latency; time spent below the first level is stall time.
+     */
+    uint64_t memory_latency = 0;
+    bool timed() const;
+    uint64_t level_cycles(size_t level) const;
+    uint64_t memory_cycles() const { return main_memory_accesses * memory_latency; }
+    uint64_t total_cycles() const;
+    double amat() const;  // Average cycles per first-level access
+
+    // Non-blocking MSHR timing, enabled by the config's "timing" section
+    TimingModel timing;
+
+    // Completes end-of-run accounting
+    void finish();
+
+    /**
+     * Warmup support: full() is true once every data level's array and the L1I hold a line in every
+     * slot they can use; reset_stats() zeroes all statistics while keeping cache contents and
+     * replacement state
+     */
+    bool full() const;
+    void reset_stats();
+
+    // Adds offset to the seed of every cache, the L1I and the TLB levels, restarting their random streams
+    void offset_seeds(uint64_t offset);
+
+    /**
+     * Checkpoints (state.cpp): contents, replacement state and counters of every cache, TLB and the
+     * hierarchy, plus the trace timer, in a versioned binary file. A file only loads into a
+     * hierarchy built from the same config. Both return 0 on success
+     */
+    int save_state(const std::string& filename, uint64_t timer);
+    int load_state(const std::string& filename, uint64_t* timer);
+    bool checkpointable();  // False (with a message) if some state would not be saved
+
+private:
+    // Prefetch requested by the prefetcher of a level, issued once the demand access is done
+    struct PrefetchRequest {
+        size_t level;
+        uint64_t addr;
+    };
+
+    template <Inclusion Mode>
+    void access_line(uint64_t addr, uint64_t lo, uint64_t hi, uint64_t timer, bool write, uint64_t pc);
+
+    template <Inclusion Mode>
+    void access_range(size_t level, uint64_t lo, uint64_t hi, uint64_t timer, bool write, uint64_t pc, bool fetch);
+
+    template <Inclusion Mode>
+    void fetch_instruction(uint64_t pc, uint64_t timer);
+
+    template <Inclusion Mode>
+    void issue_prefetches(uint64_t timer);
+
+    template <Inclusion Mode>
+    void prefetch_fill(size_t level, uint64_t addr, uint64_t timer);
+
+    void observe_prefetch(size_t level, uint64_t addr, uint64_t pc, bool hit, uint64_t useful_before);
+    void spill(size_t level, Eviction ev, uint64_t timer);
+
+    template <Inclusion Mode>
+    void handle_eviction(size_t level);
+
+    std::vector<Cache*> state_caches();
+    std::vector<uint64_t*> state_counters();
+
+    bool back_invalidate(size_t level, uint64_t addr);
+    void write_back(size_t level, uint64_t addr, uint64_t size);
+    bool write_back_range(size_t level, uint64_t addr, uint64_t size);
+
+    uint64_t line_size_;
+    bool prefetching_ = false;
+    bool sectored_ = false;  // Some level has sectored lines, so accesses carry sector masks
+    size_t depth_ = 0;       // Level the last line access was found at, caches.size() for memory
+
+    // Levels differ in line size; per level, the last line fetched and the timer of that fetch
+    bool uniform_lines_ = true;
+    std::vector<uint64_t> last_line_;
+    std::vector<uint64_t> last_timer_;
+    uint64_t last_fetch_line_ = ~0ULL;  // L1I line of the previous instruction fetch
+    std::vector<PrefetchRequest> prefetch_queue_;
+    std::vector<uint64_t> prefetch_lines_;  // Scratch buffer for Prefetcher::observe
+    std::vector<size_t> prefetch_levels_;  // Levels too large for the host caches, see prefetch()
+
+    // Line accesses of the current access_batch call and their results
+    std::vector<uint64_t> batch_addrs_;
+    std::vector<uint8_t> batch_writes_;
+    std::vector<uint8_t> batch_results_;
+};
+
+}  // namespace CacheSim
+
+#endif
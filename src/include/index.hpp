@@ -0,0 +1,82 @@
+#ifndef INDEX_HPP
+#define INDEX_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace CacheSim {
+
+// Set index functions, applied to the line address (address without offset bits)
+enum class IndexFunction { bit_select, xor_fold, prime_modulo, xor_matrix };
+
+/**
+ * Remainder by a runtime constant without a divide instruction
+ * Lemire's direct remainder computation: two multiplies and shifts, exact for all 64-bit inputs
+ */
+struct FastMod {
+    uint64_t d = 1;
+    __uint128_t M = 0;
+
+    void init(uint64_t divisor) {
+        d = divisor;
+        M = ~(__uint128_t)0 / divisor + 1;
+    }
+
+    uint64_t mod(uint64_t a) const {
+        __uint128_t low = M * a;
+        __uint128_t bottom = ((low & UINT64_MAX) * d) >> 64;
+        __uint128_t top = (low >> 64) * d;
+        return (uint64_t)((bottom + top) >> 64);
+    }
+};
+
+/* Folds the upper bits of a line address onto the low `bits` bits with XOR */
+inline uint64_t xor_fold(uint64_t line, unsigned int bits) {
+    if (bits == 0) return 0;
+    uint64_t folded = 0;
+    while (line) {
+        folded ^= line;
+        line = bits < 64 ? line >> bits : 0;
+    }
+    return bits < 64 ? folded & ((1ULL << bits) - 1) : folded;
+}
+
+/* Index bit i is the parity of the line address masked by rows[i] */
+inline uint64_t xor_matrix(uint64_t line, const std::vector<uint64_t>& rows) {
+    uint64_t index = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        index |= (uint64_t)__builtin_parityll(line & rows[i]) << i;
+    }
+    return index;
+}
+
+/* Rank of the rows over GF(2): an xor_matrix index reaches 2^rank sets */
+inline unsigned int matrix_rank(std::vector<uint64_t> rows) {
+    unsigned int rank = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (rows[i] == 0) continue;
+        rank++;
+        uint64_t pivot = rows[i] & -rows[i];
+        for (size_t j = i + 1; j < rows.size(); j++) {
+            if (rows[j] & pivot) rows[j] ^= rows[i];
+        }
+    }
+    return rank;
+}
+
+/* Largest prime not above n (n >= 2) */
+inline uint64_t largest_prime_at_most(uint64_t n) {
+    for (uint64_t p = n; p > 2; p--) {
+        bool prime = (p % 2) != 0;
+        for (uint64_t f = 3; prime && f * f <= p; f += 2) {
+            if (p % f == 0) prime = false;
+        }
+        if (prime) return p;
+    }
+    return 2;
+}
+
+}  // namespace CacheSim
+
+#endif
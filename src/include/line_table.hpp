@@ -0,0 +1,99 @@
+#ifndef LINE_TABLE_HPP
+#define LINE_TABLE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace CacheSim {
+
+/**
+ * Open-addressing hash table keyed by line address (or any key below EMPTY)
+ * Linear probing with backward-shift deletion, so erasing leaves no tombstones.
+ * The table doubles whenever it would become more than half full.
+ */
+template <typename V>
+class LineTable {
+public:
+    static constexpr uint64_t EMPTY = ~0ULL;
+
+    /* Value stored for key, or null */
+    V* find(uint64_t key) {
+        if (slots_.empty()) return nullptr;
+        for (size_t i = home(key);; i = (i + 1) & mask_) {
+            if (slots_[i].key == key) return &slots_[i].value;
+            if (slots_[i].key == EMPTY) return nullptr;
+        }
+    }
+
+    /* Value stored for key, inserting a zero value if absent */
+    V& operator[](uint64_t key) {
+        if ((count_ + 1) * 2 > slots_.size()) grow();
+        size_t i = home(key);
+        for (; slots_[i].key != EMPTY; i = (i + 1) & mask_) {
+            if (slots_[i].key == key) return slots_[i].value;
+        }
+        slots_[i] = Slot{key, V()};
+        count_++;
+        return slots_[i].value;
+    }
+
+    void erase(uint64_t key) {
+        if (slots_.empty()) return;
+        size_t i = home(key);
+        while (slots_[i].key != key) {
+            if (slots_[i].key == EMPTY) return;
+            i = (i + 1) & mask_;
+        }
+
+        // Pull later entries of the probe run back over the hole, unless that moves one before its home
+        for (size_t j = (i + 1) & mask_; slots_[j].key != EMPTY; j = (j + 1) & mask_) {
+            size_t h = home(slots_[j].key);
+            if (((j - h) & mask_) >= ((j - i) & mask_)) {
+                slots_[i] = slots_[j];
+                i = j;
+            }
+        }
+        slots_[i].key = EMPTY;
+        count_--;
+    }
+
+    /* Calls f(key, value&) for every entry, in no particular order */
+    template <typename F>
+    void for_each(F f) {
+        for (auto& slot : slots_) {
+            if (slot.key != EMPTY) f(slot.key, slot.value);
+        }
+    }
+
+    size_t size() const { return count_; }
+
+private:
+    // Key and value side by side, so a lookup touches one host cache line
+    struct Slot {
+        uint64_t key;
+        V value;
+    };
+
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    unsigned int shift_ = 64;
+    size_t count_ = 0;
+
+    size_t home(uint64_t key) const { return (key * 0x9E3779B97F4A7C15ULL) >> shift_; }
+
+    void grow() {
+        std::vector<Slot> old(slots_.empty() ? 1024 : slots_.size() * 2, Slot{EMPTY, V()});
+        old.swap(slots_);
+        mask_ = slots_.size() - 1;
+        shift_ = 64 - __builtin_ctzll(slots_.size());
+        count_ = 0;
+        for (const auto& slot : old) {
+            if (slot.key != EMPTY) (*this)[slot.key] = slot.value;
+        }
+    }
+};
+
+}  // namespace CacheSim
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef MRC_HPP
+#define MRC_HPP
+
+#include "reuse.hpp"
+#include "trace.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace CacheSim {
+
+/**
+ * Fully associative LRU miss counts for every size from 1 to max_lines lines (Mattson)
+ * One pass records the stack distance of each line access; an LRU cache of C lines hits exactly
+ * the reuses at distance below C, so its misses are the cold accesses plus the reuses at C or more.
+ * The histogram grows with the largest distance seen, and the curve stops at the number of distinct
+ * lines: every larger cache misses only on cold accesses.
+ */
+class MissRatioCurve {
+public:
+    static constexpr uint64_t MAX_LINES = 1ULL << 24;  // Largest max_lines accepted from the command line
+
+    void init(uint32_t line_size, uint64_t max_lines);
+
+    // Each line the entry's bytes touch, once per entry, as a data cache at line_size would see them
+    void access(const TraceEntry& entry);
+
+    uint32_t line_size() const { return line_size_; }
+    uint64_t max_lines() const { return cold_ < max_lines_ ? cold_ : max_lines_; }
+    uint64_t accesses() const { return accesses_; }
+
+    // Misses at every size, entry C - 1 for C lines
+    std::vector<uint64_t> misses() const;
+
+private:
+    uint32_t line_size_ = 0;
+    uint64_t max_lines_ = 0;
+    uint64_t accesses_ = 0;
+    uint64_t cold_ = 0;
+    uint64_t far_ = 0;               // Reuses at distance max_lines or more, misses at every size
+    std::vector<uint64_t> counts_;   // Reuses per distance below max_lines, up to the largest seen
+    StackDistance stack_;
+};
+
+}  // namespace CacheSim
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef MULTICORE_HPP
+#define MULTICORE_HPP
+
+#include "cache.hpp"
+#include "config.hpp"
+#include "trace.hpp"
+#include <vector>
+#include <unordered_map>
+
+namespace CacheSim {
+
+/**
+ * Several cores with private caches in front of shared levels, kept coherent by a directory
+ *
+ * Each core gets its own copy of the private levels (the caches before the first "shared" one),
+ * which are write-back and inclusive among themselves, so the last private level tells whether a
+ * core holds a line. The directory acts as a snoop filter over those copies and runs a MOESI
+ * protocol: a write gains exclusivity by invalidating every other copy (an upgrade if the writer
+ * already held the line shared), a miss served by another core's copy is a cache-to-cache transfer,
+ * and a read of a modified line leaves the writer owning the dirty data, written back when it
+ * finally evicts the line. The shared levels are non-inclusive and only see private misses that
+ * no other core could serve, plus writebacks.
+ *
+ * A miss on a line this core lost to another core's write is a coherence miss. It is a false
+ * sharing miss when none of the bytes written since the invalidation overlap the bytes accessed.
+ */
+class MulticoreSystem {
+public:
+    struct Core {
+        std::vector<Cache> caches;
+        uint64_t coherence_misses = 0;
+        uint64_t false_sharing_misses = 0;  // Subset of coherence misses
+        uint64_t invalidations = 0;         // Copies of this core invalidated by other cores' writes
+        uint64_t upgrades = 0;              // Writes to lines this core held shared
+    };
+
+    MulticoreSystem(const CacheConfig& config);
+
+    // Runs one trace entry of a core, split into lines
+    void access(unsigned int core, const TraceEntry& entry, uint64_t timer);
+
+    std::vector<Core> cores;
+    std::vector<Cache> shared;
+    uint64_t cache_to_cache_transfers = 0;
+    uint64_t main_memory_accesses = 0;
+    uint64_t main_memory_writebacks = 0;
+
+private:
+    // Directory entry for one line; bit c of each mask stands for core c
+    struct DirEntry {
+        uint64_t sharers = 0;
+        bool exclusive = false;      // The single sharer may write without telling anyone (E or M)
+        uint64_t invalidated = 0;    // Cores whose copy was invalidated and have not missed on it since
+        std::vector<uint64_t> written;  // Per core: bytes written by others since its invalidation
+    };
+
+    void access_line(unsigned int core, uint64_t addr, uint64_t bytes, bool write, uint64_t timer);
+    void invalidate_others(unsigned int core, uint64_t addr, DirEntry& entry);
+    void record_write(unsigned int core, uint64_t bytes, DirEntry& entry);
+    bool drop_private(unsigned int core, uint64_t addr);
+    void private_eviction(unsigned int core, size_t level);
+    void fetch_shared(uint64_t addr, uint64_t timer);
+    void write_back_shared(size_t level, uint64_t addr);
+
+    std::unordered_map<uint64_t, DirEntry> directory_;
+    uint64_t line_size_;
+    unsigned int offset_size_;
+    unsigned int granule_shift_;  // Bytes per bit of the written masks, lines are tracked in 64 granules
+};
+
+}  // namespace CacheSim
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef POLICIES_LFU_HPP
+#define POLICIES_LFU_HPP
+
+#include "policies/policy.hpp"
+
+namespace CacheSim {
+
+/**
+ * Min-Heap LFU tracking, keyed on CacheLine::access_count
+ * heap[i] holds the way at heap position i, pos[w] maps way w back to its heap position
+ * Empty ways have a count of 0, so the root is always the first invalid way when one exists
+ */
+struct LfuPolicy : PolicyBase<LfuPolicy> {
+    static constexpr const char* name = "lfu";
+    static constexpr bool fills_invalid_first = false;
+
+    struct LineState { int32_t heap; int32_t pos; };
+    struct SetState {};
+
+    /* Initialise heap such that line i is at heap position i */
+    static void init(View set) {
+        for (uint32_t i = 0; i < set.ways(); i++) {
+            set.meta[i].heap = i;
+            set.meta[i].pos = i;
+        }
+    }
+
+    static void on_hit(View set, int32_t way) { sift_down(set, set.meta[way].pos); }
+    static void on_fill(View set, int32_t way) { sift_down(set, set.meta[way].pos); }
+
+    // The emptied way now has count 0 and belongs at the root
+    static void on_invalidate(View set, int32_t way) { sift_up(set, set.meta[way].pos); }
+
+    // O(1) LFU Victim Selection, root of the heap
+    static int32_t victim(View set) { return set.meta[0].heap; }
+
+    /* Swaps two elements in the LFU heap and updates their positions */
+    static void swap_heap(View set, int32_t h1, int32_t h2) {
+        int32_t line1 = set.meta[h1].heap;
+        int32_t line2 = set.meta[h2].heap;
+
+        set.meta[h1].heap = line2;
+        set.meta[h2].heap = line1;
+
+        set.meta[line1].pos = h2;
+        set.meta[line2].pos = h1;
+    }
+
+    /* Prefer smaller count, break ties with smaller physical index */
+    static bool is_smaller(View set, int32_t line_a, int32_t line_b) {
+        if (set.lines[line_a].access_count != set.lines[line_b].access_count) {
+            return set.lines[line_a].access_count < set.lines[line_b].access_count;
+        }
+        return line_a < line_b; // Tie-breaker
+    }
+
+    /* Maintains the heap property after a count increase, ensuring O(log n) victim selection */
+    static void sift_down(View set, int32_t heap_idx) {
+        int32_t size = set.ways();
+
+        while (true) {
+            int32_t left = 2 * heap_idx + 1;
+            int32_t right = 2 * heap_idx + 2;
+            int32_t smallest = heap_idx;
+
+            if (left < size && is_smaller(set, set.meta[left].heap, set.meta[smallest].heap)) {
+                smallest = left;
+            }
+            if (right < size && is_smaller(set, set.meta[right].heap, set.meta[smallest].heap)) {
+                smallest = right;
+            }
+
+            if (smallest == heap_idx) break;
+            swap_heap(set, heap_idx, smallest);
+            heap_idx = smallest; // Continue sifting down
+        }
+    }
+
+    /* Restores the heap property after a count decrease */
+    static void sift_up(View set, int32_t heap_idx) {
+        while (heap_idx > 0) {
+            int32_t parent = (heap_idx - 1) / 2;
+            if (!is_smaller(set, set.meta[heap_idx].heap, set.meta[parent].heap)) break;
+            swap_heap(set, heap_idx, parent);
+            heap_idx = parent;
+        }
+    }
+};
+
+}  // namespace CacheSim
+
+#endif
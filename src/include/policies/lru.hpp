@@ -0,0 +1,67 @@
+#ifndef POLICIES_LRU_HPP
+#define POLICIES_LRU_HPP
+
+#include "policies/policy.hpp"
+
+namespace CacheSim {
+
+/**
+ * LRU Doubly linked list
+ * Allows for O(1) updates for lru tracking
+ * Most recently used lines at the head, least recently used at the tail
+ * On every access, accessed line is moved to the head
+ */
+struct LruPolicy : PolicyBase<LruPolicy> {
+    static constexpr const char* name = "lru";
+
+    struct LineState { int32_t prev; int32_t next; };
+    struct SetState { int32_t head; int32_t tail; };
+
+    /* Pre-link all lines in the set */
+    static void init(View set) {
+        uint32_t ways = set.ways();
+        set.state->head = 0;
+        set.state->tail = ways - 1;
+
+        for (uint32_t i = 0; i < ways; i++) {
+            set.meta[i].prev = i - 1;
+            set.meta[i].next = (i == ways - 1) ? -1 : i + 1;
+        }
+    }
+
+    static void on_hit(View set, int32_t way) { move_to_mru(set, way); }
+    static void on_fill(View set, int32_t way) { move_to_mru(set, way); }
+
+    static int32_t victim(View set) { return set.state->tail; }
+
+    /* Helper to move a cache line to the Most Recently Used (head) position */
+    static void move_to_mru(View set, int32_t line_idx) {
+        auto* meta = set.meta;
+        int32_t head = set.state->head;
+
+        if (head == line_idx) return; // Already at MRU
+
+        // Unlink from current position
+        int32_t prev = meta[line_idx].prev;
+        int32_t next = meta[line_idx].next;
+
+        if (prev != -1) meta[prev].next = next;
+        if (next != -1) meta[next].prev = prev;
+
+        // If it was the tail, update the tail
+        if (set.state->tail == line_idx) {
+            set.state->tail = prev;
+        }
+
+        // Move to head
+        meta[line_idx].prev = -1;
+        meta[line_idx].next = head;
+        if (head != -1) meta[head].prev = line_idx;
+
+        set.state->head = line_idx;
+    }
+};
+
+}  // namespace CacheSim
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef POLICIES_POLICY_HPP
+#define POLICIES_POLICY_HPP
+
+#include "cache.hpp"
+#include <type_traits>
+
+namespace CacheSim {
+
+/**
+ * View of a single set handed to replacement policies
+ * lines is the shared tag storage, meta and state are the policy's own per-line and per-set records
+ * meta is null when the policy declares an empty LineState; hint is the engine's way hint, null without one
+ */
+template <typename Policy>
+struct SetView {
+    using LineState = typename Policy::LineState;
+    using SetState = typename Policy::SetState;
+
+    Span<CacheLine> lines;
+    LineState* meta;
+    SetState* state;
+    uint32_t* hint;
+    Cache* cache;
+
+    uint32_t ways() const { return (uint32_t)lines.size(); }
+
+    /* Builds the view of set idx from the cache's raw metadata arrays, or its sparse block */
+    static SetView at(Cache* c, uint64_t idx) {
+        if (c->sparse_sets.enabled) {
+            const SparseSets& sparse = c->sparse_sets;
+            unsigned char* p = c->sparse_sets.set(c, idx);
+            LineState* m = nullptr;
+            if (!std::is_empty<LineState>::value) m = reinterpret_cast<LineState*>(p + sparse.meta_offset);
+            return SetView{Span<CacheLine>(reinterpret_cast<CacheLine*>(p), c->lines_per_set), m,
+                           reinterpret_cast<SetState*>(p + sparse.state_offset),
+                           c->way_hinting ? reinterpret_cast<uint32_t*>(p + sparse.hint_offset) : nullptr, c};
+        }
+
+        LineState* m = nullptr;
+        if (!std::is_empty<LineState>::value) {
+            m = reinterpret_cast<LineState*>(c->line_meta.data()) + idx * c->lines_per_set;
+        }
+        SetState* s = reinterpret_cast<SetState*>(c->set_meta.data()) + idx;
+        uint32_t* hint = c->way_hinting ? &c->way_hints[idx] : nullptr;
+        return SetView{Span<CacheLine>(&c->storage[idx * c->lines_per_set], c->lines_per_set), m, s, hint, c};
+    }
+};
+
+/**
+ * CRTP base for replacement policies
+ *
+ * A policy derives from PolicyBase<Self>, declares trivially copyable LineState and SetState
+ * records, a config name, and provides static hooks:
+ *   init(view)           - set up a fresh set (metadata starts zeroed)
+ *   on_hit(view, way)    - a lookup hit the line in this way
+ *   on_fill(view, way)   - a new line was written into this way
+ *   victim(view)         - choose the way to evict from a full set
+ *   on_invalidate(view, way) - the line in this way was dropped (valid and access_count cleared)
+ * Hooks are resolved at compile time, so the access path has no per-access dispatch on policy.
+ * fills_invalid_first controls whether the engine prefers empty ways before calling victim().
+ */
+template <typename Derived>
+struct PolicyBase {
+    using View = SetView<Derived>;
+
+    static constexpr bool fills_invalid_first = true;
+
+    static void init(View) {}
+    static void on_hit(View, int32_t) {}
+    static void on_fill(View, int32_t) {}
+    static void on_invalidate(View, int32_t) {}
+};
+
+}  // namespace CacheSim
+
+#endif
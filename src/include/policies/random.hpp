@@ -0,0 +1,22 @@
+#ifndef POLICIES_RANDOM_HPP
+#define POLICIES_RANDOM_HPP
+
+#include "policies/policy.hpp"
+
+namespace CacheSim {
+
+/* Random: victims drawn from the cache's seeded generator, so runs are reproducible */
+struct RandomPolicy : PolicyBase<RandomPolicy> {
+    static constexpr const char* name = "random";
+
+    struct LineState {};
+    struct SetState {};
+
+    static int32_t victim(View set) {
+        return set.cache->rng.below(set.ways());
+    }
+};
+
+}  // namespace CacheSim
+
+#endif
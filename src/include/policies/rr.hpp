@@ -0,0 +1,24 @@
+#ifndef POLICIES_RR_HPP
+#define POLICIES_RR_HPP
+
+#include "policies/policy.hpp"
+
+namespace CacheSim {
+
+/* Round robin: each set cycles through its ways in order */
+struct RoundRobinPolicy : PolicyBase<RoundRobinPolicy> {
+    static constexpr const char* name = "rr";
+
+    struct LineState {};
+    struct SetState { uint32_t next; };
+
+    static int32_t victim(View set) {
+        int32_t victim = set.state->next;
+        set.state->next = (victim + 1) % set.ways();
+        return victim;
+    }
+};
+
+}  // namespace CacheSim
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef PREFETCH_HPP
+#define PREFETCH_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace CacheSim {
+
+enum class PrefetcherKind { none, next_line, stream, stride };
+
+/**
+ * Hardware prefetcher attached to one cache
+ * Works on line numbers of its cache (address >> offset_size). The hierarchy reports every demand
+ * access through observe() and performs the fills it asks for; the cache engine tags those lines so
+ * usefulness and pollution are counted exactly.
+ *
+ *   next_line: on a miss or first hit to a prefetched line, fetch the following lines
+ *   stream:    tracks up to `streams` miss streams with a direction, runs up to `distance` lines ahead
+ *   stride:    PC-indexed reference prediction table (Chen & Baer), prefetches once a stride is steady
+ * Each trigger issues at most `degree` lines, starting `distance` lines (or strides) ahead.
+ */
+struct Prefetcher {
+    PrefetcherKind kind = PrefetcherKind::none;
+    unsigned int degree = 1;
+    unsigned int distance = 0;     // 0 picks the kind's default
+    unsigned int streams = 16;
+    unsigned int table_size = 256;
+
+    // Statistics
+    uint64_t issued = 0;     // Lines filled by the prefetcher
+    uint64_t useful = 0;     // Prefetched lines later hit by a demand access
+    uint64_t unused = 0;     // Prefetched lines evicted before any demand access
+    uint64_t pollution = 0;  // Demand misses to lines a prefetch fill had evicted
+
+    /**
+     * Lines displaced by prefetch fills, for pollution accounting: a filter of line + 1 (0 when empty)
+     * with as many entries as the cache has lines, up to 1 << 20, in hashed buckets of DISPLACED_WAYS
+     * kept in insertion order. A line is forgotten when it is filled again by any means, or when
+     * DISPLACED_WAYS newer displaced lines have entered its bucket.
+     */
+    static constexpr unsigned int DISPLACED_WAYS = 8;
+    std::vector<uint64_t> displaced;
+
+    // Sets up the tables; lines is the number of lines of the cache it fills
+    void init(uint64_t lines);
+
+    void displace(uint64_t line) {
+        uint64_t* bucket = displaced_bucket(line);
+        for (unsigned int w = DISPLACED_WAYS - 1; w > 0; w--) bucket[w] = bucket[w - 1];
+        bucket[0] = line + 1;
+    }
+
+    // Called for every fill of line into the cache, returns true if a prefetch had displaced it
+    bool refill(uint64_t line) {
+        if (displaced.empty()) return false;
+        uint64_t* bucket = displaced_bucket(line);
+        for (unsigned int w = 0; w < DISPLACED_WAYS; w++) {
+            if (bucket[w] == line + 1) {
+                bucket[w] = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Reports a demand access; appends the line numbers to prefetch to out
+    void observe(uint64_t line, uint64_t pc, bool hit, bool prefetch_hit, std::vector<uint64_t>* out);
+
+private:
+    struct Stream {
+        bool valid;
+        int64_t dir;        // +1 / -1 once a direction has been seen, 0 before
+        unsigned int confidence;
+        uint64_t last;      // Last line that trained the stream
+        uint64_t head;      // Furthest line prefetched so far
+        uint64_t lru;
+    };
+
+    // Reference prediction table entry
+    enum class RptState : uint8_t { initial, transient, steady, no_pred };
+    struct RptEntry {
+        uint64_t pc;
+        uint64_t last;
+        int64_t stride;
+        RptState state;
+        bool valid;
+    };
+
+    uint64_t* displaced_bucket(uint64_t line) {
+        return &displaced[((line * 0x9E3779B97F4A7C15ULL) >> displaced_shift_) * DISPLACED_WAYS];
+    }
+
+    void observe_stream(uint64_t line, std::vector<uint64_t>* out);
+    void observe_stride(uint64_t line, uint64_t pc, std::vector<uint64_t>* out);
+
+    std::vector<Stream> stream_table_;
+    std::vector<RptEntry> rpt_;
+    uint64_t stream_clock_ = 0;
+    unsigned int displaced_shift_ = 64;
+};
+
+}  // namespace CacheSim
+
+#endif
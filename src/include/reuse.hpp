@@ -0,0 +1,67 @@
+#ifndef REUSE_HPP
+#define REUSE_HPP
+
+#include "line_table.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace CacheSim {
+
+struct Cache;
+
+/**
+ * LRU stack distances in O(log n) per access (Bennett-Kruskal)
+ * Every access takes the next slot of an access clock, and a bitmap over the slots holds a 1 at
+ * each line's latest access, so the distance of a reuse is the number of 1s after the line's
+ * previous slot. A Fenwick tree counts the 1s per 64-slot word, 64 times smaller than one over
+ * slots; the word being filled joins it once complete. When the slots run out, each line's slot
+ * is renumbered to its rank among the live slots, leaving room for ROOM - 1 accesses per line.
+ */
+class StackDistance {
+public:
+    static constexpr uint64_t COLD = ~0ULL;
+
+    // Distinct other lines accessed since line's previous access, COLD for its first access
+    uint64_t access(uint64_t line);
+
+    uint64_t lines() const { return live_; }
+
+private:
+    static constexpr uint64_t MIN_WORDS = 1 << 10;
+    static constexpr uint64_t ROOM = 16;  // Slots per live line after compaction, at 1 bit each
+
+    std::vector<uint64_t> bits_;  // 1 at each line's latest slot
+    std::vector<uint32_t> tree_;  // Fenwick tree over the complete words of bits_, 1-based
+    uint64_t now_ = 0;            // Next free slot
+    uint64_t live_ = 0;           // Distinct lines, the number of 1s in bits_
+    LineTable<uint64_t> last_;    // Line -> slot of its latest access, plus one
+
+    void add(uint64_t word, int32_t delta);
+    uint64_t prefix(uint64_t end) const;  // 1s in words [0, end)
+    uint64_t rank(uint64_t slot) const;   // 1s in slots [0, slot)
+    void compact();
+};
+
+/**
+ * Log-binned stack distance histogram of a cache's demand accesses
+ * Bucket 0 counts distance 0 (the same line again), bucket k >= 1 distances in [2^(k-1), 2^k).
+ */
+struct ReuseProfile {
+    uint64_t cold = 0;                 // First accesses, infinite distance
+    std::vector<uint64_t> histogram;
+
+    bool enabled() const { return enabled_; }
+    void init();
+    void observe(uint64_t line);
+
+private:
+    bool enabled_ = false;
+    StackDistance stack_;
+};
+
+// Starts recording the cache's stack distances, see observe_accesses; repeat_hit must be off
+void profile_reuse(Cache* cache);
+
+}  // namespace CacheSim
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef RNG_HPP
+#define RNG_HPP
+
+#include <cstdint>
+
+namespace CacheSim {
+
+/* splitmix64 step, used to expand a single user seed into generator state */
+inline uint64_t splitmix64(uint64_t& x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * xoshiro256** generator
+ * Small, fast and good enough statistically for victim selection
+ * Fully determined by the seed, so runs are reproducible
+ */
+struct Rng {
+    uint64_t s[4] = {0, 0, 0, 0};
+
+    void seed(uint64_t seed) {
+        for (auto& word : s) word = splitmix64(seed);
+    }
+
+    uint64_t next() {
+        const uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const uint64_t t = s[1] << 17;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+
+        return result;
+    }
+
+    /* Uniform value in [0, n) using multiply-shift instead of modulo */
+    uint32_t below(uint32_t n) {
+        return (uint32_t)(((next() >> 32) * n) >> 32);
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+};
+
+}  // namespace CacheSim
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef SKEWED_HPP
+#define SKEWED_HPP
+
+#include "cache.hpp"
+
+namespace CacheSim {
+
+/**
+ * Skewed-associative engine
+ * Each way is indexed by its own hash of the line address, so lines that conflict in one way
+ * usually land in different rows of the others. With relocation_levels > 1 a miss walks the
+ * zcache candidate tree: lines in the first-level candidates may move to their slot in another
+ * way, widening the set of replacement candidates without more tag lookups on hits.
+ */
+
+// Bound on the candidate tree walked by zcache relocation, and so on the ways of a skewed cache
+constexpr uint32_t MAX_CANDIDATES = 64;
+
+// Sets up a skewed cache, returns false if its replacement policy has no skewed equivalent
+bool init_skewed(Cache* cache);
+
+}  // namespace CacheSim
+
+#endif
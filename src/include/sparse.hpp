@@ -0,0 +1,58 @@
+#ifndef SPARSE_HPP
+#define SPARSE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace CacheSim {
+
+struct Cache;
+
+/**
+ * Set store of very large caches, allocated as the trace touches it
+ * Sets are grouped into blocks of 1 << block_shift sets behind a directory of block pointers.
+ * A block is allocated zeroed on the first access to any of its sets and its sets are then
+ * initialised by the replacement policy, so host memory follows the sets in use rather than
+ * the configured size. Each set keeps its lines, policy records and way hint together.
+ */
+struct SparseSets {
+    // Host bytes a block aims for, and the dense size above which init_cache picks this store
+    static constexpr size_t BLOCK_BYTES = 64 << 10;
+    static constexpr size_t THRESHOLD_BYTES = 64 << 20;
+
+    bool enabled = false;
+    unsigned int block_shift = 0;
+    uint64_t block_mask = 0;
+    size_t set_bytes = 0;     // Stride of one set within a block
+    size_t meta_offset = 0;   // Policy line records, set record and way hint, relative to the set's lines
+    size_t state_offset = 0;
+    size_t hint_offset = 0;
+    size_t allocated_bytes = 0;
+    void (*init_sets)(Cache* cache, uint64_t first, uint64_t count) = nullptr;  // Policy setup of a new block
+    std::vector<std::vector<uint64_t>> blocks;  // Empty until first touched
+
+    // Lays out sets of lines_per_set lines with the given policy record sizes; blocks start untouched
+    void init(uint64_t num_sets, uint32_t lines_per_set, size_t line_state_bytes, size_t set_state_bytes);
+
+    /* Start of set idx, allocating its block on first touch */
+    unsigned char* set(Cache* cache, uint64_t idx) {
+        std::vector<uint64_t>& block = blocks[idx >> block_shift];
+        if (block.empty()) allocate(cache, idx >> block_shift);
+        return reinterpret_cast<unsigned char*>(block.data()) + (idx & block_mask) * set_bytes;
+    }
+
+    /* Start of set idx, or null if its block was never touched */
+    const unsigned char* find(uint64_t idx) const {
+        const std::vector<uint64_t>& block = blocks[idx >> block_shift];
+        if (block.empty()) return nullptr;
+        return reinterpret_cast<const unsigned char*>(block.data()) + (idx & block_mask) * set_bytes;
+    }
+
+private:
+    void allocate(Cache* cache, uint64_t block);
+};
+
+}  // namespace CacheSim
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef TIMING_HPP
+#define TIMING_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+
+namespace CacheSim {
+
+/**
+ * Miss status holding registers of one level
+ * Outstanding misses are kept in a min-heap on completion time plus a map from line to completion,
+ * so time only advances from one completion event to the next. Occupancy is accumulated per cycle
+ * into a histogram as entries retire.
+ */
+struct MshrFile {
+    unsigned int capacity = 0;
+
+    // Statistics
+    uint64_t allocations = 0;   // Primary misses
+    uint64_t merges = 0;        // Secondary misses merged into an outstanding entry
+    uint64_t full_stalls = 0;   // Misses that found every entry busy
+    uint64_t stall_cycles = 0;  // Cycles those misses waited for an entry
+    std::vector<uint64_t> occupancy_cycles;  // Cycles spent with k entries busy, k = 0..capacity
+
+    void init(unsigned int entries);
+
+    // Retires entries completing by time t, accounting occupancy up to t
+    void advance(uint64_t t);
+
+    // Completion time of an outstanding miss for line, or 0
+    uint64_t pending(uint64_t line) const;
+
+    // Earliest time at or after t an entry is free; retires up to that time
+    uint64_t reserve(uint64_t t);
+
+    void insert(uint64_t line, uint64_t completion);
+
+private:
+    std::vector<std::pair<uint64_t, uint64_t>> heap_;  // (completion, line), min-heap
+    std::unordered_map<uint64_t, uint64_t> lines_;     // line -> completion
+    uint64_t now_ = 0;
+};
+
+/**
+ * Non-blocking timing model layered on the functional hierarchy
+ * The functional model decides where each line is found; this model only assigns times. Trace
+ * entries issue in order, one every issue_interval cycles, without waiting for earlier misses.
+ * A miss at a level takes an MSHR entry (waiting for one if all are busy) until the line returns
+ * from below; a later access to that line while it is outstanding merges into the entry, even if
+ * the functional model already reports a hit.
+ */
+class TimingModel {
+public:
+    struct Level {
+        uint64_t hit_latency;
+        unsigned int offset_size;
+        MshrFile mshr;
+    };
+
+    bool enabled = false;
+    uint64_t issue_interval = 1;
+    uint64_t memory_latency = 0;
+    std::vector<Level> levels;
+
+    uint64_t issue_time = 0;          // Issue time of the current trace entry
+    uint64_t finish_time = 0;         // Latest completion so far
+    uint64_t issue_stall_cycles = 0;  // Issue delayed by a full first-level MSHR file
+
+    // Starts the next trace entry
+    void next_entry() { issue_time += issue_interval; }
+
+    // Times one line access of the current entry, found at `depth` (levels.size() for memory)
+    void access(uint64_t addr, size_t depth);
+
+    // Accounts MSHR occupancy up to finish_time
+    void finish();
+
+private:
+    uint64_t fetch(size_t level, uint64_t addr, size_t depth, uint64_t t);
+};
+
+}  // namespace CacheSim
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef TLB_HPP
+#define TLB_HPP
+
+#include "cache.hpp"
+#include <vector>
+
+namespace CacheSim {
+
+// x86-64 style radix page table: level 0 (PML4) down to level 3 (PT)
+constexpr unsigned int PAGE_TABLE_LEVELS = 4;
+
+/* log2 of the bytes mapped by one entry of a page table level: 39 (PML4) .. 12 (PT) */
+inline unsigned int page_table_shift(unsigned int level) {
+    return 12 + 9 * (PAGE_TABLE_LEVELS - 1 - level);
+}
+
+/**
+ * TLBs for one page size
+ * Each TLB is a Cache whose lines are pages, so the set-associative engine and replacement
+ * policies are shared with the data caches. The second level is optional.
+ */
+struct PageClass {
+    uint64_t page_size;
+    unsigned int leaf_level;  // Table level holding the leaf entry: 3 for 4K, 2 for 2M, 1 for 1G
+    Cache l1;
+    Cache l2;
+    bool has_l2 = false;
+    uint64_t walks = 0;
+};
+
+// Page walk cache: caches the entries of one upper table level, its lines span what an entry maps
+struct WalkCache {
+    unsigned int level;
+    Cache cache;
+};
+
+// Virtual address range [start, end) backed by pages of one class
+struct PageRegion {
+    uint64_t start;
+    uint64_t end;
+    size_t page_class;
+};
+
+/**
+ * Translation model run alongside the data caches
+ * Addresses are translated (identity mapped) page by page: the L1 TLB for the page's size, then
+ * its L2 TLB, then a page walk. A walk starts below the deepest walk cache that hits and costs
+ * one memory reference per remaining table level. Walk references are counted, not sent
+ * through the data caches.
+ */
+class Tlb {
+public:
+    std::vector<PageClass> classes;
+    std::vector<WalkCache> walk_caches;
+    std::vector<PageRegion> regions;  // Sorted by start, non-overlapping
+    size_t default_class = 0;
+
+    uint64_t walks = 0;
+    uint64_t walk_memory_references = 0;
+
+    bool enabled() const { return !classes.empty(); }
+
+    // Builds the level -> walk cache lookup, call once the tables above are filled in
+    void init();
+
+    // Translates every page touched by [addr, addr + size)
+    void translate(uint64_t addr, uint64_t size, uint64_t timer);
+
+private:
+    size_t class_of(uint64_t addr) const;
+    void walk(PageClass& pc, uint64_t addr, uint64_t timer);
+
+    int walk_cache_at_[PAGE_TABLE_LEVELS] = {-1, -1, -1, -1};
+};
+
+}  // namespace CacheSim
+
+#endif
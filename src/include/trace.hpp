@@ -11,6 +11,12 @@ struct TraceEntry {
     uint64_t addr;
     char op;
     int size;
+
+    // Stores are marked 'W' (or 'S'), anything else is treated as a load
+    bool is_write() const {
+        char c = op | 0x20;
+        return c == 'w' || c == 's';
+    }
 };
 
 // Memory-mapped trace file reader
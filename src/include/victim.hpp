@@ -0,0 +1,70 @@
+#ifndef VICTIM_HPP
+#define VICTIM_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace CacheSim {
+
+/**
+ * Small fully associative buffer holding lines evicted from a cache's main array
+ * Entries are keyed by line address. The tag array is padded to whole vectors and scanned
+ * four tags at a time, and is only consulted on a main-array miss.
+ */
+struct VictimCache {
+    static constexpr uint64_t EMPTY = ~0ULL;  // No line address reaches this value
+    static constexpr uint32_t LANES = 4;
+
+    uint32_t entries = 0;
+    std::vector<uint64_t> tags;    // Line addresses, EMPTY when unused
+    std::vector<uint64_t> stamps;  // Time of insertion, oldest entry is replaced first
+    std::vector<uint8_t> dirty;
+    uint64_t hits = 0;
+
+    void init(uint32_t n) {
+        entries = n;
+        uint32_t padded = (n + LANES - 1) / LANES * LANES;
+        tags.assign(padded, EMPTY);
+        stamps.assign(padded, 0);
+        dirty.assign(padded, 0);
+    }
+
+    /* Returns the entry holding line, or -1 */
+    int32_t find(uint64_t line) const {
+        typedef uint64_t u64x4 __attribute__((vector_size(32)));
+        const u64x4 key = {line, line, line, line};
+
+        for (uint32_t i = 0; i < tags.size(); i += LANES) {
+            u64x4 v;
+            std::memcpy(&v, &tags[i], sizeof(v));
+            u64x4 eq = v == key;
+            if (eq[0] | eq[1] | eq[2] | eq[3]) {
+                for (uint32_t j = 0; j < LANES; j++) {
+                    if (eq[j]) return i + j;
+                }
+            }
+        }
+        return -1;
+    }
+
+    /* Slot to receive a newly evicted line: an empty entry, otherwise the oldest */
+    uint32_t slot_for_insert() const {
+        uint32_t best = 0;
+        for (uint32_t i = 0; i < entries; i++) {
+            if (tags[i] == EMPTY) return i;
+            if (stamps[i] < stamps[best]) best = i;
+        }
+        return best;
+    }
+
+    void put(uint32_t slot, uint64_t line, uint64_t timer, bool is_dirty) {
+        tags[slot] = line;
+        stamps[slot] = timer;
+        dirty[slot] = is_dirty;
+    }
+};
+
+}  // namespace CacheSim
+
+#endif
@@ -1,28 +1,193 @@
 #include "cache.hpp"
 #include "config.hpp"
 #include "trace.hpp"
+#include "hierarchy.hpp"
+#include "multicore.hpp"
+#include "mrc.hpp"
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
 #include <rapidjson/document.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/prettywriter.h>
 
 using namespace CacheSim;
 
-/* Pretty printing */
-void print_stats(const CacheConfig& config, uint64_t main_memory_accesses) {
-    rapidjson::Document doc;
-    doc.SetObject();
+// Command line options
+struct Options {
+    std::string config_file;
+    std::vector<std::string> trace_files;  // One per core in multi-core mode
+    unsigned seeds = 0;  // Number of seeds to run side by side, 0 for a single run
+    bool check_fast_path = false;  // Run a copy without the same-line fast path and compare
+    std::string load_state;  // Checkpoint to start from, empty for a cold start
+    std::string save_state;  // Where to write the state at the end of the run
+    uint64_t warmup = 0;             // Trace entries simulated before statistics are reset
+    bool warmup_until_full = false;  // Warm up until every level is full
+    bool classify_misses = false;    // Split misses into compulsory, capacity and conflict
+    bool reuse_distance = false;     // Stack distance histogram per level
+    uint64_t mrc_lines = 0;          // Largest size of the miss ratio curve in lines, 0 to simulate
+    bool mrc_csv = false;            // Print the curve as CSV instead of JSON
+};
+
+// Number of trace entries buffered per chunk when running several seeds
+static constexpr size_t SEED_CHUNK = 1 << 16;
+
+// Trace entries per access_batch call for single direct-mapped levels
+static constexpr size_t DIRECT_BATCH = 64;
+
+// Trace entries whose sets are prefetched before any of them is simulated
+static constexpr size_t PREFETCH_GROUP = 16;
+
+/* Counters every cache reports */
+static rapidjson::Value cache_counters(const Cache& cache, rapidjson::Document::AllocatorType& allocator) {
+    rapidjson::Value cache_obj(rapidjson::kObjectType);
+    cache_obj.AddMember("hits", cache.hits, allocator);
+    cache_obj.AddMember("misses", cache.misses, allocator);
+    cache_obj.AddMember("read_hits", cache.hits - cache.write_hits, allocator);
+    cache_obj.AddMember("read_misses", cache.misses - cache.write_misses, allocator);
+    cache_obj.AddMember("write_hits", cache.write_hits, allocator);
+    cache_obj.AddMember("write_misses", cache.write_misses, allocator);
+    cache_obj.AddMember("writebacks", cache.writebacks, allocator);
+    return cache_obj;
+}
+
+/* Compulsory, capacity and conflict misses and the stack distance histogram, when recorded */
+static void add_analyses(rapidjson::Value& obj, const Cache& cache, rapidjson::Document::AllocatorType& allocator) {
+    if (cache.miss_classes.enabled()) {
+        obj.AddMember("compulsory_misses", cache.miss_classes.compulsory, allocator);
+        obj.AddMember("capacity_misses", cache.miss_classes.capacity, allocator);
+        obj.AddMember("conflict_misses", cache.miss_classes.conflict, allocator);
+    }
+    if (cache.reuse.enabled()) {
+        rapidjson::Value reuse_obj(rapidjson::kObjectType);
+        rapidjson::Value histogram(rapidjson::kArrayType);
+        for (uint64_t n : cache.reuse.histogram) histogram.PushBack(n, allocator);
+        reuse_obj.AddMember("line_size", (uint64_t)cache.line_size, allocator);
+        reuse_obj.AddMember("cold", cache.reuse.cold, allocator);
+        reuse_obj.AddMember("histogram", histogram, allocator);
+        obj.AddMember("stack_distance", reuse_obj, allocator);
+    }
+}
+
+/* Hit and miss counters of a TLB or walk cache */
+static rapidjson::Value translation_stats(const Cache& cache, rapidjson::Document::AllocatorType& allocator) {
+    rapidjson::Value obj(rapidjson::kObjectType);
+    obj.AddMember("hits", cache.hits, allocator);
+    obj.AddMember("misses", cache.misses, allocator);
+    return obj;
+}
+
+/* TLB section of the output */
+static rapidjson::Value tlb_stats(const Tlb& tlb, rapidjson::Document::AllocatorType& allocator) {
+    static const char* const level_names[] = {"pml4", "pdpt", "pd"};
+    rapidjson::Value tlb_obj(rapidjson::kObjectType);
+
+    rapidjson::Value pages(rapidjson::kArrayType);
+    for (const auto& pc : tlb.classes) {
+        rapidjson::Value page_obj(rapidjson::kObjectType);
+        page_obj.AddMember("page_size", pc.page_size, allocator);
+        page_obj.AddMember("l1", translation_stats(pc.l1, allocator), allocator);
+        if (pc.has_l2) page_obj.AddMember("l2", translation_stats(pc.l2, allocator), allocator);
+        page_obj.AddMember("walks", pc.walks, allocator);
+        pages.PushBack(page_obj, allocator);
+    }
+    tlb_obj.AddMember("pages", pages, allocator);
+
+    if (!tlb.walk_caches.empty()) {
+        rapidjson::Value walk_caches(rapidjson::kArrayType);
+        for (const auto& wc : tlb.walk_caches) {
+            rapidjson::Value wc_obj = translation_stats(wc.cache, allocator);
+            wc_obj.AddMember("level", rapidjson::StringRef(level_names[wc.level]), allocator);
+            walk_caches.PushBack(wc_obj, allocator);
+        }
+        tlb_obj.AddMember("walk_caches", walk_caches, allocator);
+    }
+
+    tlb_obj.AddMember("walks", tlb.walks, allocator);
+    tlb_obj.AddMember("walk_memory_references", tlb.walk_memory_references, allocator);
+    return tlb_obj;
+}
+
+/* Adds the statistics of a single-core run to doc, at the top level */
+static void add_stats(rapidjson::Document& doc, const Hierarchy& hierarchy) {
     rapidjson::Document::AllocatorType& allocator = doc.GetAllocator();
 
     rapidjson::Value caches_array(rapidjson::kArrayType);
 
     // Iterate over each cache and add its stats to the JSON array
-    for (const auto& cache : config.caches) {
-        rapidjson::Value cache_obj(rapidjson::kObjectType);
-        
-        cache_obj.AddMember("hits", cache.hits, allocator);
-        cache_obj.AddMember("misses", cache.misses, allocator);
-        
+    for (size_t level = 0; level < hierarchy.caches.size(); level++) {
+        const Cache& cache = hierarchy.caches[level];
+        rapidjson::Value cache_obj = cache_counters(cache, allocator);
+        add_analyses(cache_obj, cache, allocator);
+        if (cache.kind == CacheKind::skewed) {
+            cache_obj.AddMember("relocations", cache.relocations, allocator);
+        }
+        if (cache.sector_shift != cache.offset_size) {
+            cache_obj.AddMember("sector_misses", cache.sector_misses, allocator);
+            cache_obj.AddMember("sector_fills", cache.sector_fills, allocator);
+        }
+        if (cache.victim.entries) {
+            cache_obj.AddMember("victim_hits", cache.victim.hits, allocator);
+        }
+        if (cache.way_hinting) {
+            // Share of array hits in the predicted way, i.e. way prediction accuracy
+            uint64_t predicted = cache.way_hint_hits + cache.way_hint_misses;
+            cache_obj.AddMember("way_hint_hits", cache.way_hint_hits, allocator);
+            cache_obj.AddMember("way_hint_rate", predicted ? (double)cache.way_hint_hits / predicted : 0.0, allocator);
+        }
+        if (hierarchy.timing.enabled) {
+            const MshrFile& mshr = hierarchy.timing.levels[level].mshr;
+            rapidjson::Value mshr_obj(rapidjson::kObjectType);
+            uint64_t cycles = 0, weighted = 0;
+            rapidjson::Value histogram(rapidjson::kArrayType);
+            for (size_t k = 0; k < mshr.occupancy_cycles.size(); k++) {
+                histogram.PushBack(mshr.occupancy_cycles[k], allocator);
+                cycles += mshr.occupancy_cycles[k];
+                weighted += k * mshr.occupancy_cycles[k];
+            }
+            uint64_t requests = mshr.allocations + mshr.merges;
+            mshr_obj.AddMember("entries", mshr.capacity, allocator);
+            mshr_obj.AddMember("allocations", mshr.allocations, allocator);
+            mshr_obj.AddMember("merges", mshr.merges, allocator);
+            mshr_obj.AddMember("merge_rate", requests ? (double)mshr.merges / requests : 0.0, allocator);
+            mshr_obj.AddMember("full_stalls", mshr.full_stalls, allocator);
+            mshr_obj.AddMember("stall_cycles", mshr.stall_cycles, allocator);
+            mshr_obj.AddMember("mean_occupancy", cycles ? (double)weighted / cycles : 0.0, allocator);
+            mshr_obj.AddMember("occupancy_cycles", histogram, allocator);
+            cache_obj.AddMember("mshr", mshr_obj, allocator);
+        }
+        if (hierarchy.timed()) {
+            // Lookups below the first level only happen while an access is stalled
+            cache_obj.AddMember(rapidjson::StringRef(level == 0 ? "cycles" : "stall_cycles"),
+                                hierarchy.level_cycles(level), allocator);
+        }
+        if (hierarchy.inclusion == Inclusion::inclusive) {
+            cache_obj.AddMember("inclusion_victims", cache.inclusion_victims, allocator);
+        }
+        if (hierarchy.split_l1 && level > 0) {
+            // Shared levels: the part of hits and misses serving L1I misses
+            cache_obj.AddMember("instruction_hits", hierarchy.instruction_hits[level], allocator);
+            cache_obj.AddMember("instruction_misses", hierarchy.instruction_misses[level], allocator);
+        }
+        if (cache.prefetcher.kind != PrefetcherKind::none) {
+            const Prefetcher& pf = cache.prefetcher;
+            rapidjson::Value pf_obj(rapidjson::kObjectType);
+            pf_obj.AddMember("issued", pf.issued, allocator);
+            pf_obj.AddMember("useful", pf.useful, allocator);
+            pf_obj.AddMember("unused", pf.unused, allocator);
+            pf_obj.AddMember("pollution", pf.pollution, allocator);
+            // Accuracy: share of prefetches used; coverage: share of would-be misses removed
+            pf_obj.AddMember("accuracy", pf.issued ? (double)pf.useful / pf.issued : 0.0, allocator);
+            pf_obj.AddMember("coverage",
+                             pf.useful + cache.misses ? (double)pf.useful / (pf.useful + cache.misses) : 0.0,
+                             allocator);
+            cache_obj.AddMember("prefetch", pf_obj, allocator);
+        }
+
         rapidjson::Value name_val;
         name_val.SetString(cache.name.c_str(), cache.name.length(), allocator);
         cache_obj.AddMember("name", name_val, allocator);
@@ -31,7 +196,191 @@ void print_stats(const CacheConfig& config, uint64_t main_memory_accesses) {
     }
 
     doc.AddMember("caches", caches_array, allocator);
-    doc.AddMember("main_memory_accesses", main_memory_accesses, allocator);
+    if (hierarchy.split_l1) {
+        const Cache& icache = hierarchy.icache;
+        rapidjson::Value icache_obj(rapidjson::kObjectType);
+        icache_obj.AddMember("fetches", hierarchy.instruction_fetches, allocator);
+        icache_obj.AddMember("hits", icache.hits, allocator);
+        icache_obj.AddMember("misses", icache.misses, allocator);
+        add_analyses(icache_obj, icache, allocator);
+        if (icache.victim.entries) icache_obj.AddMember("victim_hits", icache.victim.hits, allocator);
+        if (hierarchy.inclusion == Inclusion::inclusive) {
+            icache_obj.AddMember("inclusion_victims", icache.inclusion_victims, allocator);
+        }
+        if (hierarchy.timed()) {
+            icache_obj.AddMember("cycles", (icache.hits + icache.misses) * icache.hit_latency, allocator);
+        }
+        rapidjson::Value name_val;
+        name_val.SetString(icache.name.c_str(), icache.name.length(), allocator);
+        icache_obj.AddMember("name", name_val, allocator);
+        doc.AddMember("icache", icache_obj, allocator);
+        doc.AddMember("instruction_memory_accesses", hierarchy.instruction_memory_accesses, allocator);
+    }
+    doc.AddMember("main_memory_accesses", hierarchy.main_memory_accesses, allocator);
+    doc.AddMember("main_memory_writebacks", hierarchy.main_memory_writebacks, allocator);
+    doc.AddMember("main_memory_writes", hierarchy.main_memory_writes, allocator);
+    if (hierarchy.prefetching()) {
+        doc.AddMember("main_memory_prefetches", hierarchy.main_memory_prefetches, allocator);
+    }
+    if (hierarchy.tlb.enabled()) {
+        doc.AddMember("tlbs", tlb_stats(hierarchy.tlb, allocator), allocator);
+    }
+    if (hierarchy.timing.enabled) {
+        rapidjson::Value timing_obj(rapidjson::kObjectType);
+        timing_obj.AddMember("cycles", hierarchy.timing.finish_time, allocator);
+        timing_obj.AddMember("issue_stall_cycles", hierarchy.timing.issue_stall_cycles, allocator);
+        doc.AddMember("timing", timing_obj, allocator);
+    }
+    if (hierarchy.timed()) {
+        doc.AddMember("memory_stall_cycles", hierarchy.memory_cycles(), allocator);
+        doc.AddMember("total_cycles", hierarchy.total_cycles(), allocator);
+        doc.AddMember("amat", hierarchy.amat(), allocator);
+    }
+}
+
+/**
+ * Pretty printing
+ * After a warmup, the statistics of the warmup part come first under "warmup"
+ */
+void print_stats(const Hierarchy& hierarchy, rapidjson::Document* warmup = nullptr) {
+    rapidjson::Document doc;
+    doc.SetObject();
+    if (warmup) doc.AddMember("warmup", rapidjson::Value(*warmup, doc.GetAllocator()), doc.GetAllocator());
+    add_stats(doc, hierarchy);
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    std::cout << buffer.GetString() << "\n";
+}
+
+/* Pretty printing for multi-core runs: private caches per core, shared caches and coherence counters */
+void print_multicore_stats(const MulticoreSystem& system) {
+    rapidjson::Document doc;
+    doc.SetObject();
+    rapidjson::Document::AllocatorType& allocator = doc.GetAllocator();
+
+    // Adds the caches of one list, with their names, to a JSON array
+    auto cache_array = [&](const std::vector<Cache>& caches) {
+        rapidjson::Value array(rapidjson::kArrayType);
+        for (const auto& cache : caches) {
+            rapidjson::Value cache_obj = cache_counters(cache, allocator);
+            rapidjson::Value name_val;
+            name_val.SetString(cache.name.c_str(), cache.name.length(), allocator);
+            cache_obj.AddMember("name", name_val, allocator);
+            array.PushBack(cache_obj, allocator);
+        }
+        return array;
+    };
+
+    rapidjson::Value cores_array(rapidjson::kArrayType);
+    uint64_t invalidations = 0, upgrades = 0, coherence_misses = 0, false_sharing = 0;
+    for (const auto& core : system.cores) {
+        rapidjson::Value core_obj(rapidjson::kObjectType);
+        core_obj.AddMember("caches", cache_array(core.caches), allocator);
+        core_obj.AddMember("coherence_misses", core.coherence_misses, allocator);
+        core_obj.AddMember("false_sharing_misses", core.false_sharing_misses, allocator);
+        core_obj.AddMember("invalidations", core.invalidations, allocator);
+        core_obj.AddMember("upgrades", core.upgrades, allocator);
+        cores_array.PushBack(core_obj, allocator);
+
+        invalidations += core.invalidations;
+        upgrades += core.upgrades;
+        coherence_misses += core.coherence_misses;
+        false_sharing += core.false_sharing_misses;
+    }
+
+    doc.AddMember("cores", cores_array, allocator);
+    doc.AddMember("shared_caches", cache_array(system.shared), allocator);
+    doc.AddMember("coherence_misses", coherence_misses, allocator);
+    doc.AddMember("false_sharing_misses", false_sharing, allocator);
+    doc.AddMember("invalidations", invalidations, allocator);
+    doc.AddMember("upgrades", upgrades, allocator);
+    doc.AddMember("cache_to_cache_transfers", system.cache_to_cache_transfers, allocator);
+    doc.AddMember("main_memory_accesses", system.main_memory_accesses, allocator);
+    doc.AddMember("main_memory_writebacks", system.main_memory_writebacks, allocator);
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    std::cout << buffer.GetString() << "\n";
+}
+
+/* Sample mean and variance of a counter across seeds */
+static void mean_variance(const std::vector<double>& values, double* mean, double* variance) {
+    double sum = 0;
+    for (double v : values) sum += v;
+    *mean = sum / values.size();
+
+    double sq = 0;
+    for (double v : values) sq += (v - *mean) * (v - *mean);
+    *variance = values.size() > 1 ? sq / (values.size() - 1) : 0.0;
+}
+
+/**
+ * Mean and variance across seeds of every number in the replicas' statistics, in the layout of a single run
+ * A member x becomes x_mean and x_variance, an array element {mean, variance}; strings are the first replica's
+ */
+static rapidjson::Value seed_summary(const std::vector<const rapidjson::Value*>& values,
+                                     rapidjson::Document::AllocatorType& allocator) {
+    const rapidjson::Value& first = *values[0];
+    std::vector<double> numbers(values.size());
+    double mean, variance;
+
+    if (first.IsNumber()) {
+        for (size_t r = 0; r < values.size(); r++) numbers[r] = values[r]->GetDouble();
+        mean_variance(numbers, &mean, &variance);
+        rapidjson::Value obj(rapidjson::kObjectType);
+        obj.AddMember("mean", mean, allocator);
+        obj.AddMember("variance", variance, allocator);
+        return obj;
+    }
+    if (first.IsArray()) {
+        rapidjson::Value array(rapidjson::kArrayType);
+        for (rapidjson::SizeType i = 0; i < first.Size(); i++) {
+            std::vector<const rapidjson::Value*> items;
+            for (const rapidjson::Value* v : values) items.push_back(&(*v)[i]);
+            array.PushBack(seed_summary(items, allocator), allocator);
+        }
+        return array;
+    }
+    if (!first.IsObject()) return rapidjson::Value(first, allocator);
+
+    rapidjson::Value obj(rapidjson::kObjectType);
+    for (const auto& member : first.GetObject()) {
+        std::vector<const rapidjson::Value*> items;
+        for (const rapidjson::Value* v : values) items.push_back(&(*v)[member.name]);
+        std::string name = member.name.GetString();
+
+        if (!member.value.IsNumber()) {
+            obj.AddMember(rapidjson::Value(member.name, allocator), seed_summary(items, allocator), allocator);
+            continue;
+        }
+        for (size_t r = 0; r < items.size(); r++) numbers[r] = items[r]->GetDouble();
+        mean_variance(numbers, &mean, &variance);
+        obj.AddMember(rapidjson::Value((name + "_mean").c_str(), allocator), rapidjson::Value(mean), allocator);
+        obj.AddMember(rapidjson::Value((name + "_variance").c_str(), allocator), rapidjson::Value(variance), allocator);
+    }
+    return obj;
+}
+
+/* Pretty printing for multi-seed runs, reporting mean and variance of each counter */
+void print_seed_stats(const std::vector<Hierarchy>& replicas) {
+    std::vector<rapidjson::Document> stats(replicas.size());
+    std::vector<const rapidjson::Value*> values;
+    for (size_t r = 0; r < replicas.size(); r++) {
+        stats[r].SetObject();
+        add_stats(stats[r], replicas[r]);
+        values.push_back(&stats[r]);
+    }
+
+    rapidjson::Document doc;
+    doc.SetObject();
+    rapidjson::Document::AllocatorType& allocator = doc.GetAllocator();
+    doc.CopyFrom(seed_summary(values, allocator), allocator);
+    doc.AddMember("seeds", (uint64_t)replicas.size(), allocator);
 
     rapidjson::StringBuffer buffer;
     rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
@@ -41,57 +390,408 @@ void print_stats(const CacheConfig& config, uint64_t main_memory_accesses) {
 }
 
 /**
- * Usage: ./cache-sim <config.json> <trace_file>
+ * Runs the same trace against several copies of the hierarchy, each with its own seed offset
+ * The trace is read once, into two alternating chunks: one worker per replica simulates a chunk
+ * while the next one is read, and the reader waits until every worker is done with the chunk it refills.
+ */
+int run_seeds(const Options& opts, const Hierarchy& hierarchy, TraceReader& reader) {
+    std::vector<Hierarchy> replicas(opts.seeds, hierarchy);
+    for (unsigned r = 0; r < opts.seeds; r++) replicas[r].offset_seeds(r);
+
+    std::vector<TraceEntry> chunks[2] = {std::vector<TraceEntry>(SEED_CHUNK), std::vector<TraceEntry>(SEED_CHUNK)};
+    size_t counts[2] = {0, 0};
+    uint64_t starts[2] = {0, 0};  // Timer before each chunk's first entry
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    uint64_t published = 0;                      // Chunks ready, a count of 0 marks the end of the trace
+    std::vector<uint64_t> finished(opts.seeds, 0);  // Chunks each worker is done with
+
+    std::vector<std::thread> workers;
+    for (unsigned r = 0; r < opts.seeds; r++) {
+        workers.emplace_back([&, r]() {
+            for (uint64_t n = 0;; n++) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [&]() { return published > n; });
+                }
+                const std::vector<TraceEntry>& chunk = chunks[n & 1];
+                size_t count = counts[n & 1];
+                if (count == 0) return;
+                for (size_t i = 0; i < count; i++) replicas[r].access(chunk[i], starts[n & 1] + i + 1);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                finished[r] = n + 1;
+                changed.notify_all();
+            }
+        });
+    }
+
+    uint64_t timer = 0;
+    for (uint64_t n = 0;; n++) {
+        // Chunk n reuses the buffer of chunk n - 2
+        if (n >= 2) {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() {
+                for (uint64_t f : finished) {
+                    if (f < n - 1) return false;
+                }
+                return true;
+            });
+        }
+
+        std::vector<TraceEntry>& chunk = chunks[n & 1];
+        size_t count = 0;
+        while (count < SEED_CHUNK && reader.next(chunk[count])) count++;
+        counts[n & 1] = count;
+        starts[n & 1] = timer;
+        timer += count;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        published = n + 1;
+        changed.notify_all();
+        if (count == 0) break;
+    }
+    for (auto& worker : workers) worker.join();
+
+    for (auto& replica : replicas) replica.finish();
+    print_seed_stats(replicas);
+    return 0;
+}
+
+/**
+ * Miss ratio curve mode: no hierarchy is simulated, the trace's data accesses at the first level's
+ * line size give the fully associative LRU misses of every size up to opts.mrc_lines in one pass
+ */
+int run_mrc(const Options& opts, const CacheConfig& config, TraceReader& reader) {
+    MissRatioCurve curve;
+    curve.init(config.caches[0].line_size, opts.mrc_lines);
+
+    TraceEntry entry;
+    while (reader.next(entry)) curve.access(entry);
+
+    std::vector<uint64_t> misses = curve.misses();
+    uint64_t accesses = curve.accesses();
+    auto ratio = [&](uint64_t m) { return accesses ? (double)m / accesses : 0.0; };
+
+    if (opts.mrc_csv) {
+        std::cout << "lines,bytes,misses,miss_ratio\n";
+        for (uint64_t c = 1; c <= misses.size(); c++) {
+            std::cout << c << "," << c * curve.line_size() << "," << misses[c - 1] << "," << ratio(misses[c - 1])
+                      << "\n";
+        }
+        return 0;
+    }
+
+    rapidjson::Document doc;
+    doc.SetObject();
+    rapidjson::Document::AllocatorType& allocator = doc.GetAllocator();
+
+    rapidjson::Value sizes(rapidjson::kArrayType);
+    for (uint64_t c = 1; c <= misses.size(); c++) {
+        rapidjson::Value size_obj(rapidjson::kObjectType);
+        size_obj.AddMember("lines", c, allocator);
+        size_obj.AddMember("bytes", c * curve.line_size(), allocator);
+        size_obj.AddMember("misses", misses[c - 1], allocator);
+        size_obj.AddMember("miss_ratio", ratio(misses[c - 1]), allocator);
+        sizes.PushBack(size_obj, allocator);
+    }
+
+    doc.AddMember("line_size", curve.line_size(), allocator);
+    doc.AddMember("accesses", accesses, allocator);
+    doc.AddMember("sizes", sizes, allocator);
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    std::cout << buffer.GetString() << "\n";
+    return 0;
+}
+
+/**
+ * Runs one trace per core, interleaved round robin in quanta of trace entries
+ * A core whose trace has ended drops out of the rotation; the timer advances per entry
+ */
+int run_multicore(const Options& opts, const CacheConfig& config) {
+    if (opts.trace_files.size() != config.cores) {
+        std::cerr << "Config has " << config.cores << " cores but " << opts.trace_files.size() << " traces were given\n";
+        return 1;
+    }
+
+    std::vector<TraceReader> readers(config.cores);
+    for (unsigned int c = 0; c < config.cores; c++) {
+        if (!readers[c].open(opts.trace_files[c])) return 1;
+    }
+
+    MulticoreSystem system(config);
+    std::vector<bool> done(config.cores, false);
+    unsigned int running = config.cores;
+    uint64_t timer = 0;
+    TraceEntry entry;
+
+    while (running > 0) {
+        for (unsigned int c = 0; c < config.cores; c++) {
+            for (unsigned int i = 0; i < config.quantum && !done[c]; i++) {
+                if (!readers[c].next(entry)) {
+                    done[c] = true;
+                    running--;
+                    break;
+                }
+                system.access(c, entry, ++timer);
+            }
+        }
+    }
+
+    print_multicore_stats(system);
+    return 0;
+}
+
+/* Single-run loop for batchable hierarchies, DIRECT_BATCH entries at a time */
+void run_batched(Hierarchy& hierarchy, TraceReader& reader, uint64_t* timer) {
+    std::vector<TraceEntry> batch(DIRECT_BATCH);
+    size_t count;
+    do {
+        count = 0;
+        while (count < batch.size() && reader.next(batch[count])) count++;
+        hierarchy.access_batch(batch.data(), count);
+        *timer += count;
+    } while (count == batch.size());
+}
+
+/* Returns the first level whose counters differ, caches.size() for memory, or -1 if all match */
+static int counters_differ(const Hierarchy& a, const Hierarchy& b) {
+    for (size_t level = 0; level < a.caches.size(); level++) {
+        const Cache& x = a.caches[level];
+        const Cache& y = b.caches[level];
+        if (x.hits != y.hits || x.misses != y.misses || x.write_hits != y.write_hits ||
+            x.writebacks != y.writebacks || x.way_hint_hits != y.way_hint_hits) {
+            return (int)level;
+        }
+    }
+    if (a.main_memory_accesses != b.main_memory_accesses || a.main_memory_writes != b.main_memory_writes ||
+        a.main_memory_writebacks != b.main_memory_writebacks) {
+        return (int)a.caches.size();
+    }
+    return -1;
+}
+
+/**
+ * Debug run for --check-fast-path: a reference hierarchy without the same-line fast path
+ * follows the trace in lockstep and every counter is compared after each entry
+ */
+int run_checked(Hierarchy& hierarchy, TraceReader& reader) {
+    Hierarchy reference = hierarchy;
+    reference.fast_path = false;
+
+    uint64_t timer = 0;
+    TraceEntry entry;
+    while (reader.next(entry)) {
+        timer++;
+        hierarchy.access(entry, timer);
+        reference.access(entry, timer);
+
+        int level = counters_differ(hierarchy, reference);
+        if (level != -1) {
+            std::cerr << "Fast path diverged at entry " << timer << " ("
+                      << (level == (int)hierarchy.caches.size() ? "memory" : hierarchy.caches[level].name) << ")\n";
+            return 1;
+        }
+    }
+    hierarchy.finish();
+
+    std::cerr << "Fast path matched the full lookup over " << timer << " entries\n";
+    print_stats(hierarchy);
+    return 0;
+}
+
+/* Parses positional arguments and --options, returns 0 on success */
+int parse_args(int argc, char* argv[], Options* opts) {
+    std::vector<const char*> positional;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--seeds") == 0 && i + 1 < argc) {
+            int k = std::atoi(argv[++i]);
+            if (k < 1) {
+                std::cerr << "--seeds expects a positive count\n";
+                return 1;
+            }
+            opts->seeds = k;
+        } else if (std::strcmp(argv[i], "--load-state") == 0 && i + 1 < argc) {
+            opts->load_state = argv[++i];
+        } else if (std::strcmp(argv[i], "--save-state") == 0 && i + 1 < argc) {
+            opts->save_state = argv[++i];
+        } else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            long long n = std::atoll(argv[++i]);
+            if (n < 1) {
+                std::cerr << "--warmup expects a positive number of entries\n";
+                return 1;
+            }
+            opts->warmup = n;
+        } else if (std::strcmp(argv[i], "--warmup-until-full") == 0) {
+            opts->warmup_until_full = true;
+        } else if (std::strcmp(argv[i], "--classify-misses") == 0) {
+            opts->classify_misses = true;
+        } else if (std::strcmp(argv[i], "--reuse-distance") == 0) {
+            opts->reuse_distance = true;
+        } else if (std::strcmp(argv[i], "--mrc") == 0 && i + 1 < argc) {
+            long long n = std::atoll(argv[++i]);
+            if (n <= 0 || (uint64_t)n > MissRatioCurve::MAX_LINES) {
+                std::cerr << "--mrc expects a number of lines from 1 to " << MissRatioCurve::MAX_LINES << "\n";
+                return 1;
+            }
+            opts->mrc_lines = (uint64_t)n;
+        } else if (std::strcmp(argv[i], "--mrc-csv") == 0) {
+            opts->mrc_csv = true;
+        } else if (std::strcmp(argv[i], "--check-fast-path") == 0) {
+            opts->check_fast_path = true;
+        } else if (std::strncmp(argv[i], "--", 2) == 0) {
+            std::cerr << "Unknown option: " << argv[i] << "\n";
+            return 1;
+        } else {
+            positional.push_back(argv[i]);
+        }
+    }
+
+    if (positional.size() < 2) return 1;
+    opts->config_file = positional[0];
+    opts->trace_files.assign(positional.begin() + 1, positional.end());
+    return 0;
+}
+
+/**
+ * Usage: ./cache-sim <config.json> <trace_file>... [--seeds K] [--check-fast-path] [--load-state F] [--save-state F]
+ *                    [--warmup N | --warmup-until-full] [--classify-misses] [--reuse-distance]
+ *                    [--mrc MAX [--mrc-csv]]
  */
 int main(int argc, char* argv[]) {
-    if (argc < 3) {
-        std::cerr << "Usage: " << argv[0] << " <config.json> <trace_file>\n";
+    Options opts;
+    if (parse_args(argc, argv, &opts) != 0) {
+        std::cerr << "Usage: " << argv[0] << " <config.json> <trace_file>... [--seeds K] [--check-fast-path]"
+                  << " [--load-state F] [--save-state F] [--warmup N | --warmup-until-full] [--classify-misses]"
+                  << " [--reuse-distance] [--mrc MAX [--mrc-csv]]\n";
         return 1;
     }
 
     CacheConfig config;
     // Parse the cache configuration from the JSON file
-    if (parse_config(&config, argv[1]) != 0) {
+    if (parse_config(&config, opts.config_file) != 0) {
+        return 1;
+    }
+
+    bool mrc = opts.mrc_lines > 0;
+    if (opts.mrc_csv && !mrc) {
+        std::cerr << "--mrc-csv needs --mrc\n";
+        return 1;
+    }
+    if (mrc && (config.cores > 1 || opts.seeds > 0 || opts.warmup > 0 || opts.warmup_until_full ||
+                !opts.load_state.empty() || !opts.save_state.empty() || opts.classify_misses ||
+                opts.reuse_distance || opts.check_fast_path)) {
+        std::cerr << "--mrc runs on its own, without other options or multiple cores\n";
+        return 1;
+    }
+
+    if (config.cores > 1) {
+        if (opts.seeds > 0 || opts.warmup > 0 || opts.warmup_until_full || !opts.load_state.empty() ||
+            !opts.save_state.empty() || opts.classify_misses || opts.reuse_distance) {
+            std::cerr << "--seeds, --warmup, state files and access analyses are not supported in multi-core mode\n";
+            return 1;
+        }
+        return run_multicore(opts, config);
+    }
+    if (opts.trace_files.size() != 1) {
+        std::cerr << "Expected a single trace file\n";
         return 1;
     }
 
     TraceReader reader;
-    if (!reader.open(argv[2])) {
+    if (!reader.open(opts.trace_files[0])) {
         return 1;
     }
 
-    uint64_t timer = 0;                  // Simulated time or access counter
-    uint64_t main_memory_accesses = 0;
-    uint64_t line_size = config.caches[0].line_size;
-    TraceEntry entry;
+    if (mrc) {
+        return run_mrc(opts, config, reader);
+    }
 
-    while (reader.next(entry)) {
-        timer++;
+    Hierarchy hierarchy(std::move(config));
 
-        // Calculate the range of cache lines affected by this memory access
-        uint64_t start_line = entry.addr / line_size;
-        uint64_t end_line = (entry.addr + entry.size - 1) / line_size;
+    bool checkpoints = !opts.load_state.empty() || !opts.save_state.empty();
+    bool warmup = opts.warmup > 0 || opts.warmup_until_full;
+    if ((checkpoints || warmup) && (opts.seeds > 0 || opts.check_fast_path)) {
+        std::cerr << "--load-state, --save-state and --warmup need a plain single run\n";
+        return 1;
+    }
+    if (warmup && hierarchy.timing.enabled) {
+        std::cerr << "--warmup is not supported with the timing model\n";
+        return 1;
+    }
+    if (opts.classify_misses || opts.reuse_distance) {
+        if (opts.seeds > 0) {
+            std::cerr << "--classify-misses and --reuse-distance are not reported across seeds\n";
+            return 1;
+        }
+        if (opts.classify_misses) hierarchy.classify_misses();
+        if (opts.reuse_distance) hierarchy.profile_reuse();
+    }
+    if (opts.seeds > 0) {
+        return run_seeds(opts, hierarchy, reader);
+    }
+    if (opts.check_fast_path) {
+        return run_checked(hierarchy, reader);
+    }
 
-        // For each cache line in the access range
-        for (uint64_t line = start_line; line <= end_line; line++) {
-            uint64_t addr = line * line_size;
-            bool hit = false;
+    uint64_t timer = 0;                  // Simulated time or access counter
+    TraceEntry entry;
 
-            // Check each cache in order; stop at first hit
-            for (auto& cache : config.caches) {
-                if (access_cache(&cache, addr, timer)) {
-                    hit = true;
-                    break;
-                }
-            }
+    // A checkpoint restores the caches, counters and timer where the saved run stopped
+    if (checkpoints && !hierarchy.checkpointable()) {
+        return 1;
+    }
+    if (!opts.load_state.empty() && hierarchy.load_state(opts.load_state, &timer) != 0) {
+        return 1;
+    }
 
-            // If not found in any cache, count as main memory access
-            if (!hit) {
-                main_memory_accesses++;
-            }
+    // Warmup: simulate up to the boundary, keep its statistics apart, then count from zero
+    rapidjson::Document warmup_stats;
+    if (warmup) {
+        uint64_t entries = 0;
+        while ((opts.warmup == 0 || entries < opts.warmup) && !(opts.warmup_until_full && hierarchy.full()) &&
+               reader.next(entry)) {
+            hierarchy.access(entry, ++timer);
+            entries++;
+        }
+        if (opts.warmup_until_full && !hierarchy.full() && (opts.warmup == 0 || entries < opts.warmup)) {
+            std::cerr << "Warning: the trace ended before every level was full, so nothing was measured\n";
         }
+        warmup_stats.SetObject();
+        warmup_stats.AddMember("entries", entries, warmup_stats.GetAllocator());
+        warmup_stats.AddMember("full", hierarchy.full(), warmup_stats.GetAllocator());
+        add_stats(warmup_stats, hierarchy);
+        hierarchy.reset_stats();
     }
 
-    print_stats(config, main_memory_accesses);
+    if (hierarchy.batchable()) {
+        run_batched(hierarchy, reader, &timer);
+    } else if (hierarchy.host_prefetching()) {
+        // Group prefetching: fetch the sets of a group of entries, then simulate them in order
+        TraceEntry group[PREFETCH_GROUP];
+        size_t count;
+        do {
+            count = 0;
+            while (count < PREFETCH_GROUP && reader.next(group[count])) hierarchy.prefetch(group[count++]);
+            for (size_t i = 0; i < count; i++) hierarchy.access(group[i], ++timer);
+        } while (count == PREFETCH_GROUP);
+    } else {
+        while (reader.next(entry)) {
+            timer++;
+            hierarchy.access(entry, timer);
+        }
+    }
+    hierarchy.finish();
+
+    if (!opts.save_state.empty() && hierarchy.save_state(opts.save_state, timer) != 0) {
+        return 1;
+    }
+    print_stats(hierarchy, warmup ? &warmup_stats : nullptr);
     return 0;
-}
\ No newline at end of file
+}
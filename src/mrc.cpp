@@ -0,0 +1,41 @@
+#include "mrc.hpp"
+
+namespace CacheSim {
+
+void MissRatioCurve::init(uint32_t line_size, uint64_t max_lines) {
+    line_size_ = line_size;
+    max_lines_ = max_lines;
+    accesses_ = cold_ = far_ = 0;
+    counts_.clear();
+    stack_ = StackDistance();
+}
+
+void MissRatioCurve::access(const TraceEntry& entry) {
+    uint64_t first = entry.addr / line_size_;
+    uint64_t last = (entry.addr + entry.size - 1) / line_size_;
+
+    for (uint64_t line = first; line <= last; line++) {
+        uint64_t distance = stack_.access(line);
+        accesses_++;
+        if (distance == StackDistance::COLD) cold_++;
+        else if (distance >= max_lines_) far_++;
+        else {
+            if (distance >= counts_.size()) counts_.resize(distance + 1);
+            counts_[distance]++;
+        }
+    }
+}
+
+std::vector<uint64_t> MissRatioCurve::misses() const {
+    // Distances stay below the distinct lines seen, so counts_ never outgrows the curve
+    std::vector<uint64_t> result(max_lines());
+    uint64_t missed = cold_ + far_;
+    for (size_t c = result.size(); c-- > 0;) {
+        // A cache of c + 1 lines misses on every reuse at distance c + 1 or more
+        result[c] = missed;
+        if (c < counts_.size()) missed += counts_[c];
+    }
+    return result;
+}
+
+}  // namespace CacheSim
@@ -0,0 +1,195 @@
+#include "multicore.hpp"
+
+namespace CacheSim {
+
+MulticoreSystem::MulticoreSystem(const CacheConfig& config)
+    : cores(config.cores),
+      line_size_(config.caches[0].line_size),
+      offset_size_(config.caches[0].offset_size),
+      granule_shift_(config.caches[0].offset_size > 6 ? config.caches[0].offset_size - 6 : 0) {
+    for (const auto& cache : config.caches) {
+        if (cache.shared) {
+            shared.push_back(cache);
+        } else {
+            for (auto& core : cores) core.caches.push_back(cache);
+        }
+    }
+}
+
+/* Removes a line from every private level of a core, returns true if a copy was dirty */
+bool MulticoreSystem::drop_private(unsigned int core, uint64_t addr) {
+    bool dirty = false;
+    for (auto& cache : cores[core].caches) {
+        if (invalidate_line(&cache, addr)) dirty |= cache.evicted.dirty;
+    }
+    return dirty;
+}
+
+/* Delivers a dirty line to the first shared level at or below `level` holding it, else memory */
+void MulticoreSystem::write_back_shared(size_t level, uint64_t addr) {
+    for (; level < shared.size(); level++) {
+        if (mark_dirty(&shared[level], addr)) return;
+    }
+    main_memory_writebacks++;
+}
+
+/**
+ * Acts on a line pushed out of a private level
+ * Upper levels write dirty lines into the nearest private level below holding them (only the last
+ * private level is inclusive, so a middle level may have lost its copy); a line leaving the last
+ * private level is dropped from the levels above and from the directory.
+ */
+void MulticoreSystem::private_eviction(unsigned int core, size_t level) {
+    std::vector<Cache>& caches = cores[core].caches;
+    Eviction ev = caches[level].evicted;
+    bool dirty = ev.dirty;
+
+    if (level + 1 < caches.size()) {
+        if (dirty) {
+            caches[level].writebacks++;
+            for (size_t lower = level + 1; lower < caches.size(); lower++) {
+                if (mark_dirty(&caches[lower], ev.addr)) return;
+            }
+            write_back_shared(0, ev.addr);
+        }
+        return;
+    }
+
+    for (size_t upper = 0; upper < level; upper++) {
+        if (invalidate_line(&caches[upper], ev.addr)) {
+            caches[upper].inclusion_victims++;
+            dirty |= caches[upper].evicted.dirty;
+        }
+    }
+    if (dirty) {
+        caches[level].writebacks++;
+        write_back_shared(0, ev.addr);
+    }
+
+    auto it = directory_.find(ev.addr >> offset_size_);
+    if (it == directory_.end()) return;
+    DirEntry& entry = it->second;
+    entry.sharers &= ~(1ULL << core);
+    if (entry.sharers == 0) {
+        entry.exclusive = false;
+        if (entry.invalidated == 0) directory_.erase(it);
+    }
+}
+
+/* Invalidates every other core's copy; the written masks start tracking for those cores */
+void MulticoreSystem::invalidate_others(unsigned int core, uint64_t addr, DirEntry& entry) {
+    uint64_t others = entry.sharers & ~(1ULL << core);
+
+    while (others) {
+        unsigned int other = __builtin_ctzll(others);
+        others &= others - 1;
+
+        // Dirty data is superseded by the writer's copy, so it is not written back
+        drop_private(other, addr);
+        cores[other].invalidations++;
+
+        if (entry.written.empty()) entry.written.assign(cores.size(), 0);
+        entry.invalidated |= 1ULL << other;
+        entry.written[other] = 0;
+    }
+    entry.sharers &= 1ULL << core;
+    entry.exclusive = true;
+}
+
+/* Notes a write for the cores waiting to re-miss on the line */
+void MulticoreSystem::record_write(unsigned int core, uint64_t bytes, DirEntry& entry) {
+    uint64_t waiting = entry.invalidated & ~(1ULL << core);
+    while (waiting) {
+        unsigned int other = __builtin_ctzll(waiting);
+        waiting &= waiting - 1;
+        entry.written[other] |= bytes;
+    }
+}
+
+/* Private miss no other core can serve: look up the shared levels, then memory */
+void MulticoreSystem::fetch_shared(uint64_t addr, uint64_t timer) {
+    for (size_t level = 0; level < shared.size(); level++) {
+        Cache& cache = shared[level];
+        if (access_cache(&cache, addr, timer)) return;
+
+        if (cache.evicted.valid && cache.evicted.dirty) {
+            cache.writebacks++;
+            write_back_shared(level + 1, cache.evicted.addr);
+        }
+    }
+    main_memory_accesses++;
+}
+
+/**
+ * One line-sized access by a core
+ * bytes marks the granules of the line touched by the access
+ */
+void MulticoreSystem::access_line(unsigned int core, uint64_t addr, uint64_t bytes, bool write, uint64_t timer) {
+    Core& c = cores[core];
+    const uint64_t self = 1ULL << core;
+
+    // Private levels, filling each level that misses; below a write-allocating write-back level
+    // the store has become a read for the line, as in Hierarchy::access_line
+    bool hit = false;
+    bool store = write;
+    for (size_t level = 0; level < c.caches.size() && !hit; level++) {
+        Cache& cache = c.caches[level];
+        hit = access_cache(&cache, addr, timer, store);
+        if (hit) break;
+        if (cache.evicted.valid) private_eviction(core, level);
+        if (store && cache.write_back && cache.write_allocate) store = false;
+    }
+
+    DirEntry& entry = directory_[addr >> offset_size_];
+
+    if (hit) {
+        if (write && !entry.exclusive) {
+            c.upgrades++;
+            invalidate_others(core, addr, entry);
+        }
+        if (write) record_write(core, bytes, entry);
+        return;
+    }
+
+    // Coherence miss: this core's copy was taken away by a write
+    if (entry.invalidated & self) {
+        c.coherence_misses++;
+        if ((entry.written[core] & bytes) == 0) c.false_sharing_misses++;
+        entry.invalidated &= ~self;
+    }
+
+    if (entry.sharers & ~self) {
+        // Another core supplies the line; a dirty supplier keeps ownership on a read
+        cache_to_cache_transfers++;
+        if (write) invalidate_others(core, addr, entry);
+        else entry.exclusive = false;
+    } else {
+        fetch_shared(addr, timer);
+        entry.exclusive = true;
+    }
+
+    entry.sharers |= self;
+    if (write) record_write(core, bytes, entry);
+}
+
+void MulticoreSystem::access(unsigned int core, const TraceEntry& entry, uint64_t timer) {
+    uint64_t start_line = entry.addr / line_size_;
+    uint64_t end_line = (entry.addr + entry.size - 1) / line_size_;
+    uint64_t end = entry.addr + entry.size;
+    bool write = entry.is_write();
+
+    for (uint64_t line = start_line; line <= end_line; line++) {
+        uint64_t addr = line * line_size_;
+        uint64_t lo = addr > entry.addr ? addr : entry.addr;
+        uint64_t hi = addr + line_size_ < end ? addr + line_size_ : end;
+
+        // Granules [first, last] of the line touched by the access
+        uint64_t first = (lo - addr) >> granule_shift_;
+        uint64_t last = (hi - 1 - addr) >> granule_shift_;
+        uint64_t bytes = (last == 63 ? ~0ULL : ((2ULL << last) - 1)) & ~((1ULL << first) - 1);
+
+        access_line(core, addr, bytes, write, timer);
+    }
+}
+
+}  // namespace CacheSim
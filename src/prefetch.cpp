@@ -0,0 +1,133 @@
+#include "prefetch.hpp"
+
+namespace CacheSim {
+
+void Prefetcher::init(uint64_t lines) {
+    if (distance == 0) distance = (kind == PrefetcherKind::stream) ? 8 : 1;
+    if (degree == 0) degree = 1;
+
+    // Power-of-two bucket count, at least one bucket and at most 1 << 20 entries
+    unsigned int bits = 1;
+    while (bits < 17 && ((uint64_t)DISPLACED_WAYS << bits) < lines) bits++;
+    displaced.assign((uint64_t)DISPLACED_WAYS << bits, 0);
+    displaced_shift_ = 64 - bits;
+
+    if (kind == PrefetcherKind::stream) stream_table_.assign(streams, Stream{});
+    if (kind == PrefetcherKind::stride) rpt_.assign(table_size, RptEntry{});
+}
+
+void Prefetcher::observe(uint64_t line, uint64_t pc, bool hit, bool prefetch_hit, std::vector<uint64_t>* out) {
+    switch (kind) {
+        case PrefetcherKind::none:
+            break;
+        case PrefetcherKind::next_line:
+            // Tagged next-line: triggered by misses and by the first use of a prefetched line
+            if (!hit || prefetch_hit) {
+                for (unsigned int k = 0; k < degree; k++) out->push_back(line + distance + k);
+            }
+            break;
+        case PrefetcherKind::stream:
+            if (!hit || prefetch_hit) observe_stream(line, out);
+            break;
+        case PrefetcherKind::stride:
+            observe_stride(line, pc, out);
+            break;
+    }
+}
+
+/**
+ * Stream prefetcher
+ * A trigger within `distance` lines of a stream's last line trains it; two steps in the same
+ * direction confirm it. A confirmed stream keeps its prefetch head up to `distance` lines ahead,
+ * issuing at most `degree` new lines per trigger. Unmatched triggers replace the LRU stream.
+ */
+void Prefetcher::observe_stream(uint64_t line, std::vector<uint64_t>* out) {
+    stream_clock_++;
+
+    Stream* match = nullptr;
+    Stream* lru = &stream_table_[0];
+    for (auto& s : stream_table_) {
+        if (s.valid) {
+            uint64_t gap = line > s.last ? line - s.last : s.last - line;
+            if (gap <= distance) {
+                match = &s;
+                break;
+            }
+        }
+        if (!s.valid || (lru->valid && s.lru < lru->lru)) lru = &s;
+    }
+
+    if (!match) {
+        *lru = Stream{true, 0, 0, line, line, stream_clock_};
+        return;
+    }
+
+    Stream& s = *match;
+    s.lru = stream_clock_;
+    if (line == s.last) return;
+
+    int64_t dir = line > s.last ? 1 : -1;
+    if (dir == s.dir) {
+        s.confidence++;
+    } else {
+        s.dir = dir;
+        s.confidence = 1;
+        s.head = line;
+    }
+    s.last = line;
+
+    if (s.confidence < 2) return;
+
+    // Continue from the head (or the current line if the demand stream overtook it)
+    uint64_t next = (dir > 0) ? (s.head > line ? s.head : line) : (s.head < line ? s.head : line);
+    uint64_t limit = line + dir * (int64_t)distance;
+    for (unsigned int k = 0; k < degree && next != limit; k++) {
+        next += dir;
+        out->push_back(next);
+        s.head = next;
+    }
+}
+
+/**
+ * PC-indexed stride prefetcher (reference prediction table)
+ * initial -> steady on a repeated stride, otherwise transient -> no_pred as strides keep changing;
+ * a steady entry that mispredicts drops back to initial keeping its stride.
+ */
+void Prefetcher::observe_stride(uint64_t line, uint64_t pc, std::vector<uint64_t>* out) {
+    RptEntry& e = rpt_[(pc ^ (pc >> 12)) % rpt_.size()];
+
+    if (!e.valid || e.pc != pc) {
+        e = RptEntry{pc, line, 0, RptState::initial, true};
+        return;
+    }
+
+    int64_t stride = (int64_t)(line - e.last);
+    bool correct = stride == e.stride;
+
+    switch (e.state) {
+        case RptState::initial:
+            if (correct) e.state = RptState::steady;
+            else { e.stride = stride; e.state = RptState::transient; }
+            break;
+        case RptState::transient:
+            if (correct) e.state = RptState::steady;
+            else { e.stride = stride; e.state = RptState::no_pred; }
+            break;
+        case RptState::steady:
+            if (!correct) e.state = RptState::initial;
+            break;
+        case RptState::no_pred:
+            if (correct) e.state = RptState::transient;
+            else e.stride = stride;
+            break;
+    }
+    e.last = line;
+
+    if (e.state == RptState::steady && e.stride != 0) {
+        for (unsigned int k = 0; k < degree; k++) {
+            out->push_back(line + e.stride * (int64_t)(distance + k));
+        }
+    }
+}
+
+}  // namespace CacheSim
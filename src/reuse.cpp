@@ -0,0 +1,93 @@
+#include "reuse.hpp"
+#include "cache.hpp"
+#include <algorithm>
+
+namespace CacheSim {
+
+// ============================================================================
+// Stack Distance
+// ============================================================================
+
+void StackDistance::add(uint64_t word, int32_t delta) {
+    for (uint64_t i = word + 1; i < tree_.size(); i += i & (~i + 1)) tree_[i] += delta;
+}
+
+uint64_t StackDistance::prefix(uint64_t end) const {
+    uint64_t sum = 0;
+    for (uint64_t i = end; i > 0; i &= i - 1) sum += tree_[i];
+    return sum;
+}
+
+/* Words before the one being filled are all in the tree, so this holds for any slot below now_ */
+uint64_t StackDistance::rank(uint64_t slot) const {
+    uint64_t below = bits_[slot >> 6] & (((uint64_t)1 << (slot & 63)) - 1);
+    return prefix(slot >> 6) + __builtin_popcountll(below);
+}
+
+/* Moves the live slots to 0..live_-1 in access order, then rebuilds the tree in linear time */
+void StackDistance::compact() {
+    last_.for_each([this](uint64_t, uint64_t& last) { last = rank(last - 1) + 1; });
+    now_ = live_;
+
+    uint64_t words = std::max(MIN_WORDS, ((live_ + 1) * ROOM + 63) >> 6);
+    bits_.assign(words, 0);
+    for (uint64_t w = 0; w < (live_ >> 6); w++) bits_[w] = ~(uint64_t)0;
+    if (live_ & 63) bits_[live_ >> 6] = ((uint64_t)1 << (live_ & 63)) - 1;
+
+    tree_.assign(words + 1, 0);
+    for (uint64_t w = 0; w < (live_ >> 6); w++) tree_[w + 1] = 64;
+    for (uint64_t i = 1; i <= words; i++) {
+        uint64_t parent = i + (i & (~i + 1));
+        if (parent <= words) tree_[parent] += tree_[i];
+    }
+}
+
+uint64_t StackDistance::access(uint64_t line) {
+    if (now_ == bits_.size() * 64) compact();
+
+    uint64_t& last = last_[line];
+    uint64_t distance = COLD;
+    if (last) {
+        uint64_t prev = last - 1;
+        distance = prev + 1 == now_ ? 0 : live_ - 1 - rank(prev);
+        bits_[prev >> 6] &= ~((uint64_t)1 << (prev & 63));
+        if ((prev >> 6) != (now_ >> 6)) add(prev >> 6, -1);
+    } else {
+        live_++;
+    }
+
+    bits_[now_ >> 6] |= (uint64_t)1 << (now_ & 63);
+    last = ++now_;
+    if ((now_ & 63) == 0) add((now_ >> 6) - 1, __builtin_popcountll(bits_[(now_ >> 6) - 1]));
+    return distance;
+}
+
+// ============================================================================
+// Reuse Profile
+// ============================================================================
+
+void ReuseProfile::init() {
+    cold = 0;
+    histogram.clear();
+    stack_ = StackDistance();
+    enabled_ = true;
+}
+
+void ReuseProfile::observe(uint64_t line) {
+    uint64_t distance = stack_.access(line);
+    if (distance == StackDistance::COLD) {
+        cold++;
+        return;
+    }
+
+    size_t bucket = distance ? 64 - __builtin_clzll(distance) : 0;
+    if (bucket >= histogram.size()) histogram.resize(bucket + 1, 0);
+    histogram[bucket]++;
+}
+
+void profile_reuse(Cache* cache) {
+    cache->reuse.init();
+    observe_accesses(cache);
+}
+
+}  // namespace CacheSim
@@ -0,0 +1,266 @@
+#include "skewed.hpp"
+#include <cassert>
+
+namespace CacheSim {
+
+namespace {
+
+// Victim ranking across ways, using the per-line timestamps and counts
+enum class SkewRank { lru, lfu, random };
+
+/* Row of a line address in a given way, a per-way finalizer followed by a multiply-shift reduction */
+inline uint64_t skew_row(const Cache* cache, uint64_t line, uint32_t way) {
+    uint64_t h = line + (way + 1) * 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return ((h >> 32) * cache->num_sets) >> 32;
+}
+
+inline uint32_t slot_of(const Cache* cache, uint64_t line, uint32_t way) {
+    return (uint32_t)(skew_row(cache, line, way) * cache->lines_per_set + way);
+}
+
+/* True if line a is a better victim than line b */
+template <SkewRank Rank>
+inline bool better_victim(const CacheLine& a, const CacheLine& b) {
+    if (Rank == SkewRank::lfu && a.access_count != b.access_count) {
+        return a.access_count < b.access_count;
+    }
+    return a.last_access < b.last_access;
+}
+
+// Node of the relocation tree: a storage slot and the candidate whose line would move into it
+struct Candidate {
+    uint32_t slot;
+    int32_t parent;
+};
+
+/* Slot holding line, or -1 */
+inline int32_t find_slot(const Cache* cache, uint64_t line) {
+    const CacheLine* lines = cache->storage.data();
+    for (uint32_t w = 0; w < cache->lines_per_set; w++) {
+        uint32_t slot = slot_of(cache, line, w);
+        if (lines[slot].valid && lines[slot].tag == line) return slot;
+    }
+    return -1;
+}
+
+/**
+ * Skewed replacement for a line known to be absent
+ * Tags hold whole line addresses, since relocation has to rehash resident lines into other ways.
+ */
+template <SkewRank Rank>
+void fill_skewed(Cache* cache, uint64_t line, uint64_t timer, bool dirty, uint32_t sectors, bool prefetched = false) {
+    uint32_t ways = cache->lines_per_set;
+    CacheLine* lines = cache->storage.data();
+    assert(ways >= 1 && ways <= MAX_CANDIDATES);
+
+    Candidate cand[MAX_CANDIDATES];
+    cand[0] = Candidate{0, -1};
+    uint32_t n = 0;
+    int32_t victim = -1;
+    cache->evicted.valid = false;
+
+    // 1. First-level candidates: the line's own row in every way
+    for (uint32_t w = 0; w < ways; w++) {
+        cand[n++] = Candidate{slot_of(cache, line, w), -1};
+        if (victim == -1 && !lines[cand[w].slot].valid) victim = w;
+    }
+
+    // 2. Expand the candidate tree level by level, stopping early at an empty slot
+    uint32_t level_begin = 0;
+    for (unsigned int level = 1; level < cache->skew_levels && victim == -1; level++) {
+        uint32_t level_end = n;
+        for (uint32_t c = level_begin; c < level_end && victim == -1; c++) {
+            const CacheLine& resident = lines[cand[c].slot];
+            uint32_t resident_way = cand[c].slot % ways;
+
+            for (uint32_t w = 0; w < ways && n < MAX_CANDIDATES; w++) {
+                if (w == resident_way) continue;
+                uint32_t slot = slot_of(cache, resident.tag, w);
+
+                // A slot may only appear once, otherwise a relocation path could loop
+                bool seen = false;
+                for (uint32_t k = 0; k < n && !seen; k++) seen = cand[k].slot == slot;
+                if (seen) continue;
+
+                cand[n++] = Candidate{slot, (int32_t)c};
+                if (!lines[slot].valid) {
+                    victim = n - 1;
+                    break;
+                }
+            }
+        }
+        level_begin = level_end;
+    }
+
+    // 3. Rank all candidates when every slot is occupied
+    if (victim == -1) {
+        if (Rank == SkewRank::random) {
+            victim = cache->rng.below(n);
+        } else {
+            victim = 0;
+            for (uint32_t i = 1; i < n; i++) {
+                if (better_victim<Rank>(lines[cand[i].slot], lines[cand[victim].slot])) victim = i;
+            }
+        }
+        const CacheLine& old = lines[cand[victim].slot];
+        cache->evicted.valid = true;
+        cache->evicted.dirty = old.dirty;
+        cache->evicted.prefetched = old.prefetched;
+        cache->evicted.addr = old.tag << cache->offset_size;
+        if (old.prefetched) cache->prefetcher.unused++;
+    } else {
+        cache->valid_lines++;
+    }
+
+    // 4. Relocate along the path so the new line lands in one of its own first-level slots
+    int32_t v = victim;
+    while (cand[v].parent != -1) {
+        int32_t p = cand[v].parent;
+        lines[cand[v].slot] = lines[cand[p].slot];
+        cache->relocations++;
+        v = p;
+    }
+
+    CacheLine& fill = lines[cand[v].slot];
+    fill.valid = true;
+    fill.dirty = dirty;
+    fill.prefetched = prefetched;
+    fill.sectors = sectors;
+    fill.tag = line;
+    fill.last_access = timer;
+    fill.access_count = 1;
+}
+
+/* Demand lookup: every way is checked at its own row */
+template <SkewRank Rank>
+bool access_skewed(Cache* cache, uint64_t addr, uint64_t timer, bool write, uint32_t sectors) {
+    uint64_t line = addr >> cache->offset_size;
+    int32_t slot = find_slot(cache, line);
+
+    if (slot != -1) {
+        CacheLine& l = cache->storage[slot];
+        uint32_t missing = sectors & ~l.sectors;
+        if (missing) {
+            // Sector miss: fetch the absent sectors into the resident line
+            cache->misses++;
+            cache->sector_misses++;
+            cache->evicted.valid = false;
+            if (write) {
+                cache->write_misses++;
+                if (!cache->write_allocate) return false;
+            }
+            cache->sector_fills += __builtin_popcount(missing);
+            l.sectors |= missing;
+            l.dirty |= write && cache->write_back;
+            l.last_access = timer;
+            l.access_count++;
+            return false;
+        }
+
+        cache->hits++;
+        l.last_access = timer;
+        l.access_count++;
+        if (l.prefetched) {
+            l.prefetched = false;
+            cache->prefetcher.useful++;
+        }
+        if (write) {
+            cache->write_hits++;
+            l.dirty |= cache->write_back;
+        }
+        return true;
+    }
+
+    cache->misses++;
+    cache->evicted.valid = false;
+    if (write) {
+        cache->write_misses++;
+        if (!cache->write_allocate) return false;
+    }
+    cache->sector_fills += __builtin_popcount(sectors);
+    fill_skewed<Rank>(cache, line, timer, write && cache->write_back, sectors);
+    return false;
+}
+
+bool probe_skewed(Cache* cache, uint64_t addr) {
+    return find_slot(cache, addr >> cache->offset_size) != -1;
+}
+
+template <SkewRank Rank>
+void insert_skewed(Cache* cache, uint64_t addr, uint64_t timer, bool dirty, bool prefetched) {
+    uint64_t line = addr >> cache->offset_size;
+    cache->evicted.valid = false;
+
+    int32_t slot = find_slot(cache, line);
+    if (slot == -1) {
+        fill_skewed<Rank>(cache, line, timer, dirty, cache->full_sectors, prefetched);
+        return;
+    }
+    // A resident sectored line may be partial; the arriving copy is complete
+    cache->storage[slot].sectors |= cache->full_sectors;
+    cache->storage[slot].dirty |= dirty;
+}
+
+bool invalidate_skewed(Cache* cache, uint64_t addr) {
+    int32_t slot = find_slot(cache, addr >> cache->offset_size);
+    if (slot == -1) {
+        cache->evicted.valid = false;
+        return false;
+    }
+
+    CacheLine& l = cache->storage[slot];
+    cache->evicted.valid = true;
+    cache->evicted.dirty = l.dirty;
+    cache->evicted.prefetched = l.prefetched;
+    cache->evicted.addr = l.tag << cache->offset_size;
+    l.valid = false;
+    l.dirty = false;
+    l.prefetched = false;
+    l.access_count = 0;
+    cache->valid_lines--;
+    return true;
+}
+
+bool mark_dirty_skewed(Cache* cache, uint64_t addr) {
+    int32_t slot = find_slot(cache, addr >> cache->offset_size);
+    if (slot == -1) return false;
+    cache->storage[slot].dirty = true;
+    return true;
+}
+
+void init_noop(Cache*) {}
+
+template <SkewRank Rank>
+constexpr EngineOps make_skewed_ops(const char* name) {
+    return EngineOps{name, &init_noop, &access_skewed<Rank>, &probe_skewed, &insert_skewed<Rank>,
+                     &invalidate_skewed, &mark_dirty_skewed, nullptr};  // Never records a last hit
+}
+
+constexpr EngineOps skewed_engines[] = {
+    make_skewed_ops<SkewRank::lru>("lru"),
+    make_skewed_ops<SkewRank::lfu>("lfu"),
+    make_skewed_ops<SkewRank::random>("random"),
+};
+
+}  // anonymous namespace
+
+bool init_skewed(Cache* cache) {
+    // Tags keep the whole line address so relocated lines can be rehashed
+    cache->tag_shift = cache->offset_size;
+    cache->tag_size = 64 - cache->offset_size;
+    if (cache->skew_levels < 1) cache->skew_levels = 1;
+
+    for (const auto& ops : skewed_engines) {
+        if (cache->replacement_policy == ops.name) {
+            cache->engine = &ops;
+            cache->access_fn = ops.access;
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace CacheSim
@@ -0,0 +1,383 @@
+#include "hierarchy.hpp"
+#include "direct.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace CacheSim {
+
+namespace {
+
+/**
+ * State file layout (version 3), all integers little-endian as in memory:
+ *   StateHeader
+ *   HierarchyRecord                - settings shared by the levels
+ *   CacheRecord[cache_count]       - data caches, the L1I, then TLBs and walk caches
+ *   uint64_t[counter_count]        - hierarchy counters, at counters_offset
+ *   arrays                         - each starting on a STATE_ALIGN boundary
+ * Arrays are raw copies of the in-memory vectors, so a mapped file can be copied back section by section.
+ */
+constexpr char STATE_MAGIC[8] = {'C', 'S', 'I', 'M', 'S', 'T', 'A', 'T'};
+constexpr uint32_t STATE_VERSION = 3;
+constexpr uint64_t STATE_ALIGN = 64;
+
+constexpr size_t CACHE_COUNTERS = 12;
+constexpr size_t CACHE_ARRAYS = 9;
+
+struct StateHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t cache_count;
+    uint64_t timer;
+    uint64_t counter_count;
+    uint64_t counters_offset;
+};
+
+struct HierarchyRecord {
+    uint32_t inclusion;
+    uint32_t split_l1;
+    uint32_t timing;
+    uint32_t default_page_class;
+    uint64_t memory_latency;
+    uint64_t tlb_layout;  // Hash of the page classes, walk cache levels and regions
+};
+
+struct Section {
+    uint64_t offset;
+    uint64_t bytes;
+};
+
+struct CacheRecord {
+    char name[32];
+    char policy[16];
+    uint64_t size;
+    uint64_t line_size;
+    uint64_t num_sets;
+    uint64_t lines_per_set;
+    uint32_t kind;
+    uint32_t victim_entries;
+    uint32_t index_function;
+    uint32_t write_back;
+    uint32_t write_allocate;
+    uint32_t prefetcher;
+    uint64_t index_matrix;  // Hash of the xor_matrix rows
+    uint64_t sector_size;
+    uint32_t ways;
+    uint32_t skew_levels;
+    uint64_t seed;
+    uint64_t hit_latency;
+    uint64_t counters[CACHE_COUNTERS];
+    uint64_t rng[4];
+    Section arrays[CACHE_ARRAYS];
+};
+
+struct Blob {
+    void* data;
+    size_t bytes;
+};
+
+inline uint64_t align_up(uint64_t n) {
+    return (n + STATE_ALIGN - 1) & ~(STATE_ALIGN - 1);
+}
+
+/* Statistics of a cache, in file order */
+std::array<uint64_t*, CACHE_COUNTERS> cache_counters(Cache* c) {
+    return {&c->hits, &c->misses, &c->write_hits, &c->write_misses, &c->writebacks, &c->relocations,
+            &c->inclusion_victims, &c->sector_misses, &c->sector_fills, &c->way_hint_hits, &c->way_hint_misses,
+            &c->victim.hits};
+}
+
+/* Tag storage and replacement structures of a cache, in file order */
+std::array<Blob, CACHE_ARRAYS> cache_arrays(Cache* c) {
+    return {Blob{c->storage.data(), c->storage.size() * sizeof(CacheLine)},
+            Blob{c->line_meta.data(), c->line_meta.size()},
+            Blob{c->set_meta.data(), c->set_meta.size()},
+            Blob{c->way_hints.data(), c->way_hints.size() * sizeof(uint32_t)},
+            Blob{c->direct_tags.data(), c->direct_tags.size() * sizeof(uint64_t)},
+            Blob{c->direct_flags.data(), c->direct_flags.size()},
+            Blob{c->victim.tags.data(), c->victim.tags.size() * sizeof(uint64_t)},
+            Blob{c->victim.stamps.data(), c->victim.stamps.size() * sizeof(uint64_t)},
+            Blob{c->victim.dirty.data(), c->victim.dirty.size()}};
+}
+
+/* FNV-1a over the rows, enough to tell two index matrices apart */
+uint64_t hash_rows(const std::vector<uint64_t>& rows) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (uint64_t row : rows) {
+        for (int i = 0; i < 8; i++) h = (h ^ ((row >> (8 * i)) & 0xff)) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/* Describes the configuration a record was saved from, so a load can reject a different one */
+CacheRecord describe(const Cache& c) {
+    CacheRecord r;
+    std::memset(&r, 0, sizeof(r));
+    std::strncpy(r.name, c.name.c_str(), sizeof(r.name) - 1);
+    std::strncpy(r.policy, c.replacement_policy.c_str(), sizeof(r.policy) - 1);
+    r.size = c.size;
+    r.line_size = c.line_size;
+    r.num_sets = c.num_sets;
+    r.lines_per_set = c.lines_per_set;
+    r.kind = (uint32_t)c.kind;
+    r.victim_entries = c.victim.entries;
+    r.index_function = (uint32_t)c.index_function;
+    r.write_back = c.write_back;
+    r.write_allocate = c.write_allocate;
+    r.prefetcher = (uint32_t)c.prefetcher.kind;
+    r.index_matrix = hash_rows(c.index_matrix);
+    r.sector_size = c.sector_size;
+    r.ways = c.ways;
+    r.skew_levels = c.skew_levels;
+    r.seed = c.seed;
+    r.hit_latency = c.hit_latency;
+    return r;
+}
+
+/* Describes the settings outside the caches, checked like the cache records */
+HierarchyRecord describe(const Hierarchy& h) {
+    HierarchyRecord r;
+    std::memset(&r, 0, sizeof(r));
+    r.inclusion = (uint32_t)h.inclusion;
+    r.split_l1 = h.split_l1;
+    r.timing = h.timing.enabled;
+    r.default_page_class = h.tlb.default_class;
+    r.memory_latency = h.memory_latency;
+
+    std::vector<uint64_t> layout;
+    for (const auto& pc : h.tlb.classes) layout.insert(layout.end(), {pc.page_size, pc.leaf_level, pc.has_l2});
+    for (const auto& wc : h.tlb.walk_caches) layout.push_back(wc.level);
+    for (const auto& region : h.tlb.regions) layout.insert(layout.end(), {region.start, region.end, region.page_class});
+    r.tlb_layout = hash_rows(layout);
+    return r;
+}
+
+bool same_config(const CacheRecord& a, const CacheRecord& b) {
+    return std::strncmp(a.name, b.name, sizeof(a.name)) == 0 &&
+           std::strncmp(a.policy, b.policy, sizeof(a.policy)) == 0 && a.size == b.size &&
+           a.line_size == b.line_size && a.num_sets == b.num_sets && a.lines_per_set == b.lines_per_set &&
+           a.kind == b.kind && a.victim_entries == b.victim_entries && a.index_function == b.index_function &&
+           a.write_back == b.write_back && a.write_allocate == b.write_allocate && a.prefetcher == b.prefetcher &&
+           a.index_matrix == b.index_matrix && a.sector_size == b.sector_size && a.ways == b.ways &&
+           a.skew_levels == b.skew_levels && a.seed == b.seed && a.hit_latency == b.hit_latency;
+}
+
+bool same_config(const HierarchyRecord& a, const HierarchyRecord& b) {
+    return a.inclusion == b.inclusion && a.split_l1 == b.split_l1 && a.timing == b.timing &&
+           a.default_page_class == b.default_page_class && a.memory_latency == b.memory_latency &&
+           a.tlb_layout == b.tlb_layout;
+}
+
+}  // anonymous namespace
+
+/* Every cache whose contents are saved: data levels, the L1I, TLBs and walk caches */
+std::vector<Cache*> Hierarchy::state_caches() {
+    std::vector<Cache*> list;
+    for (auto& cache : caches) list.push_back(&cache);
+    if (split_l1) list.push_back(&icache);
+    for (auto& pc : tlb.classes) {
+        list.push_back(&pc.l1);
+        if (pc.has_l2) list.push_back(&pc.l2);
+    }
+    for (auto& wc : tlb.walk_caches) list.push_back(&wc.cache);
+    return list;
+}
+
+/* Hierarchy-wide counters, in file order */
+std::vector<uint64_t*> Hierarchy::state_counters() {
+    std::vector<uint64_t*> list = {&main_memory_accesses, &main_memory_writes, &main_memory_writebacks,
+                                   &main_memory_prefetches, &instruction_fetches, &instruction_memory_accesses,
+                                   &last_fetch_line_, &tlb.walks, &tlb.walk_memory_references};
+    for (auto& pc : tlb.classes) list.push_back(&pc.walks);
+    for (auto& n : instruction_hits) list.push_back(&n);
+    for (auto& n : instruction_misses) list.push_back(&n);
+    return list;
+}
+
+/* Prefetcher tables, the timing model's queues, sparse set stores and access analyses are not part of a checkpoint */
+bool Hierarchy::checkpointable() {
+    if (prefetching_ || timing.enabled) {
+        std::cerr << "Cache state files do not cover prefetchers or the timing model" << std::endl;
+        return false;
+    }
+    for (Cache* cache : state_caches()) {
+        if (cache->sparse_sets.enabled) {
+            std::cerr << "Cache state files do not cover sparse caches (" << cache->name << ")" << std::endl;
+            return false;
+        }
+        if (cache->miss_classes.enabled() || cache->reuse.enabled()) {
+            std::cerr << "Cache state files do not cover miss classification or reuse profiles" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int Hierarchy::save_state(const std::string& filename, uint64_t timer) {
+    if (!checkpointable()) return 1;
+
+    std::vector<Cache*> list = state_caches();
+    std::vector<uint64_t*> counters = state_counters();
+
+    StateHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, STATE_MAGIC, sizeof(header.magic));
+    header.version = STATE_VERSION;
+    header.cache_count = list.size();
+    header.timer = timer;
+    header.counter_count = counters.size();
+    header.counters_offset = sizeof(StateHeader) + sizeof(HierarchyRecord) + list.size() * sizeof(CacheRecord);
+    HierarchyRecord settings = describe(*this);
+
+    // Lay out the arrays after the fixed part
+    std::vector<CacheRecord> records;
+    uint64_t offset = align_up(header.counters_offset + counters.size() * sizeof(uint64_t));
+    for (Cache* cache : list) {
+        CacheRecord r = describe(*cache);
+        auto stats = cache_counters(cache);
+        for (size_t i = 0; i < CACHE_COUNTERS; i++) r.counters[i] = *stats[i];
+        std::memcpy(r.rng, cache->rng.s, sizeof(r.rng));
+
+        auto arrays = cache_arrays(cache);
+        for (size_t i = 0; i < CACHE_ARRAYS; i++) {
+            r.arrays[i] = Section{offset, arrays[i].bytes};
+            offset = align_up(offset + arrays[i].bytes);
+        }
+        records.push_back(r);
+    }
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to open state file for writing: " << filename << std::endl;
+        return 1;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&settings), sizeof(settings));
+    out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(CacheRecord));
+    for (uint64_t* n : counters) out.write(reinterpret_cast<const char*>(n), sizeof(uint64_t));
+
+    static const char padding[STATE_ALIGN] = {};
+    for (size_t c = 0; c < list.size(); c++) {
+        auto arrays = cache_arrays(list[c]);
+        for (size_t i = 0; i < CACHE_ARRAYS; i++) {
+            out.write(padding, records[c].arrays[i].offset - (uint64_t)out.tellp());
+            out.write(static_cast<const char*>(arrays[i].data), arrays[i].bytes);
+        }
+    }
+
+    if (!out) {
+        std::cerr << "Failed to write state file: " << filename << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Maps the file and copies each section into the matching cache
+ * The file must come from the same config: the hierarchy's settings and every cache's geometry and
+ * array sizes are checked before anything is modified.
+ */
+int Hierarchy::load_state(const std::string& filename, uint64_t* timer) {
+    if (!checkpointable()) return 1;
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        std::cerr << "Failed to open state file: " << filename << std::endl;
+        return 1;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) == -1 || (size_t)sb.st_size < sizeof(StateHeader)) {
+        std::cerr << "State file is truncated: " << filename << std::endl;
+        ::close(fd);
+        return 1;
+    }
+    size_t file_size = sb.st_size;
+    void* map = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "mmap failed\n";
+        return 1;
+    }
+    const char* base = static_cast<const char*>(map);
+
+    std::vector<Cache*> list = state_caches();
+    std::vector<uint64_t*> counters = state_counters();
+
+    const StateHeader* header = reinterpret_cast<const StateHeader*>(base);
+    const HierarchyRecord* settings = reinterpret_cast<const HierarchyRecord*>(base + sizeof(StateHeader));
+    const CacheRecord* records = reinterpret_cast<const CacheRecord*>(settings + 1);
+    const char* error = nullptr;
+
+    if (std::memcmp(header->magic, STATE_MAGIC, sizeof(STATE_MAGIC)) != 0) {
+        error = "not a cache state file";
+    } else if (header->version != STATE_VERSION) {
+        error = "unsupported state file version";
+    } else if (header->counters_offset !=
+                   sizeof(StateHeader) + sizeof(HierarchyRecord) + header->cache_count * sizeof(CacheRecord) ||
+               header->counters_offset > file_size ||
+               header->counter_count > (file_size - header->counters_offset) / sizeof(uint64_t)) {
+        error = "state file is truncated or corrupt";
+    } else if (header->cache_count != list.size() || header->counter_count != counters.size() ||
+               !same_config(*settings, describe(*this))) {
+        error = "saved with a different configuration";
+    } else {
+        for (size_t c = 0; c < list.size() && !error; c++) {
+            if (!same_config(records[c], describe(*list[c]))) error = "saved with a different configuration";
+            auto arrays = cache_arrays(list[c]);
+            for (size_t i = 0; i < CACHE_ARRAYS && !error; i++) {
+                const Section& s = records[c].arrays[i];
+                if (s.bytes != arrays[i].bytes) error = "saved with a different configuration";
+                else if (s.offset > file_size || s.bytes > file_size - s.offset) error = "state file is truncated";
+            }
+        }
+    }
+    if (error) {
+        std::cerr << "Cannot load " << filename << ": " << error << std::endl;
+        munmap(map, file_size);
+        return 1;
+    }
+
+    for (size_t c = 0; c < list.size(); c++) {
+        Cache* cache = list[c];
+        const CacheRecord& r = records[c];
+        auto stats = cache_counters(cache);
+        for (size_t i = 0; i < CACHE_COUNTERS; i++) *stats[i] = r.counters[i];
+        std::memcpy(cache->rng.s, r.rng, sizeof(r.rng));
+
+        auto arrays = cache_arrays(cache);
+        for (size_t i = 0; i < CACHE_ARRAYS; i++) {
+            if (arrays[i].bytes) std::memcpy(arrays[i].data, base + r.arrays[i].offset, arrays[i].bytes);
+        }
+
+        // Derived lookup structures are rebuilt rather than stored
+        if (cache->kind == CacheKind::full) {
+            for (unsigned int s = 0; s < cache->num_sets; s++) {
+                auto& tag_map = cache->tag_maps[s];
+                tag_map.clear();
+                for (uint32_t w = 0; w < cache->lines_per_set; w++) {
+                    const CacheLine& line = cache->storage[s * cache->lines_per_set + w];
+                    if (line.valid) tag_map[line.tag] = w;
+                }
+            }
+        }
+        cache->last_hit_line = ~0ULL;
+        cache->evicted.valid = false;
+        cache->valid_lines = 0;
+        for (const auto& line : cache->storage) cache->valid_lines += line.valid;
+        for (uint64_t tag : cache->direct_tags) cache->valid_lines += tag != DIRECT_EMPTY;
+    }
+
+    const uint64_t* saved = reinterpret_cast<const uint64_t*>(base + header->counters_offset);
+    for (size_t i = 0; i < counters.size(); i++) *counters[i] = saved[i];
+    *timer = header->timer;
+
+    munmap(map, file_size);
+    return 0;
+}
+
+}  // namespace CacheSim
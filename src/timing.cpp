@@ -0,0 +1,91 @@
+#include "timing.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace CacheSim {
+
+void MshrFile::init(unsigned int entries) {
+    capacity = entries;
+    occupancy_cycles.assign(entries + 1, 0);
+}
+
+void MshrFile::advance(uint64_t t) {
+    if (t < now_) return;
+
+    while (!heap_.empty() && heap_.front().first <= t) {
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<>());
+        auto [completion, line] = heap_.back();
+        heap_.pop_back();
+
+        if (completion > now_) {
+            occupancy_cycles[heap_.size() + 1] += completion - now_;
+            now_ = completion;
+        }
+        auto it = lines_.find(line);
+        if (it != lines_.end() && it->second == completion) lines_.erase(it);
+    }
+    occupancy_cycles[heap_.size()] += t - now_;
+    now_ = t;
+}
+
+uint64_t MshrFile::pending(uint64_t line) const {
+    auto it = lines_.find(line);
+    return (it != lines_.end() && it->second > now_) ? it->second : 0;
+}
+
+uint64_t MshrFile::reserve(uint64_t t) {
+    advance(t);
+    if (heap_.size() < capacity) return t;
+
+    // Full: wait for the earliest outstanding miss to return
+    uint64_t free_at = heap_.front().first;
+    full_stalls++;
+    stall_cycles += free_at - t;
+    advance(free_at);
+    return free_at;
+}
+
+void MshrFile::insert(uint64_t line, uint64_t completion) {
+    allocations++;
+    heap_.emplace_back(completion, line);
+    std::push_heap(heap_.begin(), heap_.end(), std::greater<>());
+    lines_[line] = completion;
+}
+
+/**
+ * Time at which the line is available at `level` when requested there at time t
+ * Levels above `depth` missed in the functional model and fetch from below through their MSHRs
+ */
+uint64_t TimingModel::fetch(size_t level, uint64_t addr, size_t depth, uint64_t t) {
+    if (level == levels.size()) return t + memory_latency;
+
+    Level& lv = levels[level];
+    uint64_t line = addr >> lv.offset_size;
+    lv.mshr.advance(t);
+
+    uint64_t outstanding = lv.mshr.pending(line);
+    if (outstanding) {
+        lv.mshr.merges++;
+        return std::max(outstanding, t + lv.hit_latency);
+    }
+    if (level >= depth) return t + lv.hit_latency;
+
+    uint64_t start = lv.mshr.reserve(t);
+    if (level == 0) {
+        issue_stall_cycles += start - t;
+        issue_time = std::max(issue_time, start);
+    }
+    uint64_t done = fetch(level + 1, addr, depth, start + lv.hit_latency);
+    lv.mshr.insert(line, done);
+    return done;
+}
+
+void TimingModel::access(uint64_t addr, size_t depth) {
+    finish_time = std::max(finish_time, fetch(0, addr, depth, issue_time));
+}
+
+void TimingModel::finish() {
+    for (auto& lv : levels) lv.mshr.advance(finish_time);
+}
+
+}  // namespace CacheSim
@@ -0,0 +1,57 @@
+#include "tlb.hpp"
+#include <algorithm>
+
+namespace CacheSim {
+
+void Tlb::init() {
+    for (auto& index : walk_cache_at_) index = -1;
+    for (size_t i = 0; i < walk_caches.size(); i++) {
+        walk_cache_at_[walk_caches[i].level] = (int)i;
+    }
+    std::sort(regions.begin(), regions.end(),
+              [](const PageRegion& a, const PageRegion& b) { return a.start < b.start; });
+}
+
+/* Page class of an address: the region containing it, otherwise the default */
+size_t Tlb::class_of(uint64_t addr) const {
+    auto it = std::upper_bound(regions.begin(), regions.end(), addr,
+                               [](uint64_t a, const PageRegion& r) { return a < r.start; });
+    if (it != regions.begin() && addr < (it - 1)->end) return (it - 1)->page_class;
+    return default_class;
+}
+
+/**
+ * Page walk for a TLB miss
+ * Walk caches are consulted from the deepest non-leaf level up; a hit at level k skips reading
+ * levels 0..k. Walk caches that missed are filled by the lookup itself, as the walk refills them.
+ */
+void Tlb::walk(PageClass& pc, uint64_t addr, uint64_t timer) {
+    pc.walks++;
+    walks++;
+
+    unsigned int start = 0;
+    for (int level = (int)pc.leaf_level - 1; level >= 0; level--) {
+        int index = walk_cache_at_[level];
+        if (index == -1) continue;
+        if (access_cache(&walk_caches[index].cache, addr, timer)) {
+            start = level + 1;
+            break;
+        }
+    }
+    walk_memory_references += pc.leaf_level - start + 1;
+}
+
+void Tlb::translate(uint64_t addr, uint64_t size, uint64_t timer) {
+    uint64_t end = addr + (size ? size : 1);
+
+    while (addr < end) {
+        PageClass& pc = classes[class_of(addr)];
+
+        if (!access_cache(&pc.l1, addr, timer) && !(pc.has_l2 && access_cache(&pc.l2, addr, timer))) {
+            walk(pc, addr, timer);
+        }
+        addr = (addr & ~(pc.page_size - 1)) + pc.page_size;
+    }
+}
+
+}  // namespace CacheSim
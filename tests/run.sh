@@ -0,0 +1,150 @@
+#!/bin/bash
+# Regression tests: runs the simulator on the fixtures in tests/ and compares against tests/expected
+# Usage: tests/run.sh [path/to/cache-sim]    (from the repository root or anywhere else)
+
+dir=$(cd "$(dirname "$0")" && pwd)
+sim=$(realpath "${1:-$dir/../src/cache-sim}")
+trace=$dir/traces/mixed.trace
+configs=$dir/configs
+expected=$dir/expected
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+failures=0
+
+pass() { echo "PASS $1"; }
+fail() { echo "FAIL $1: $2"; failures=$((failures + 1)); }
+
+# Runs the simulator and compares its stdout with an expected file
+expect() {
+    local name=$1 file=$2
+    shift 2
+    "$sim" "$@" > "$tmp/$name.out" 2> "$tmp/$name.err"
+    local status=$?
+    if [ $status -ne 0 ]; then
+        fail "$name" "exit status $status ($(head -n 1 "$tmp/$name.err"))"
+    elif ! diff -q "$expected/$file" "$tmp/$name.out" > /dev/null; then
+        fail "$name" "output differs from expected/$file"
+    else
+        pass "$name"
+    fi
+}
+
+# First "misses" of a JSON result, the first cache's
+first_misses() { grep -m 1 '"misses":' "$1" | tr -dc '0-9'; }
+
+# Every cache's compulsory + capacity + conflict must equal its misses; prints the caches that do not
+check_classes() {
+    awk '/"(misses|compulsory_misses|capacity_misses|conflict_misses)":/ {
+             n = $2; gsub(/[^0-9]/, "", n)
+             if ($1 == "\"misses\":") misses = n; else sum += n
+         }
+         /"name":/ { if (sum != misses) print $2; sum = 0 }' "$1"
+}
+
+# Miss ratio curve: exact output, and every size matches a fully associative LRU run of that size
+expect mrc mrc.csv "$configs/direct.json" "$trace" --mrc 256 --mrc-csv
+for lines in 1 7 64 256; do
+    printf '{"caches": [{"name": "FA", "size": %d, "line_size": 64, "kind": "full", "replacement_policy": "lru"}]}' \
+        $((lines * 64)) > "$tmp/fa.json"
+    "$sim" "$tmp/fa.json" "$trace" > "$tmp/fa.out"
+    curve=$(awk -F, -v n=$lines '$1 == n { print $3 }' "$tmp/mrc.out")
+    simulated=$(first_misses "$tmp/fa.out")
+    if [ "$curve" = "$simulated" ]; then
+        pass "mrc-$lines-lines"
+    else
+        fail "mrc-$lines-lines" "curve $curve, fully associative run $simulated"
+    fi
+done
+
+# A MAX past the distinct lines stops the curve there, where only cold misses remain; a huge MAX is refused
+"$sim" "$configs/direct.json" "$trace" --mrc 16777216 --mrc-csv > "$tmp/mrc_all.out"
+last=$(tail -n 1 "$tmp/mrc_all.out")
+if [ "${last%%,*}" = "$(cut -d, -f3 <<< "$last")" ]; then
+    pass "mrc-distinct-lines"
+else
+    fail "mrc-distinct-lines" "last row $last"
+fi
+if "$sim" "$configs/direct.json" "$trace" --mrc 1000000000000 > /dev/null 2>&1; then
+    fail "mrc-limit" "accepted --mrc 1000000000000"
+else
+    pass "mrc-limit"
+fi
+
+# Three-C split: exact output, the classes add up to the misses, and a fully associative LRU level has no conflicts
+expect classify classify.json "$configs/classify.json" "$trace" --classify-misses
+expect classify-exclusive classify-exclusive.json "$configs/exclusive.json" "$trace" --classify-misses
+for name in classify classify-exclusive; do
+    bad=$(check_classes "$tmp/$name.out")
+    if [ -z "$bad" ]; then pass "$name-sums"; else fail "$name-sums" "classes do not add up for $bad"; fi
+done
+conflicts=$(grep -m 1 '"conflict_misses":' "$tmp/classify.out" | tr -dc '0-9')
+if [ "$conflicts" = "0" ]; then pass "classify-full-lru"; else fail "classify-full-lru" "$conflicts conflict misses"; fi
+
+# State files: saving halfway and loading into a second run matches one run over the whole trace
+head -n 2000 "$trace" > "$tmp/first.trace"
+tail -n +2001 "$trace" > "$tmp/second.trace"
+"$sim" "$configs/hierarchy.json" "$tmp/first.trace" --save-state "$tmp/state.bin" > /dev/null
+expect state-round-trip hierarchy.json "$configs/hierarchy.json" "$tmp/second.trace" --load-state "$tmp/state.bin"
+if "$sim" "$configs/classify.json" "$tmp/second.trace" --load-state "$tmp/state.bin" > /dev/null 2>&1; then
+    fail "state-other-config" "loaded into a different configuration"
+else
+    pass "state-other-config"
+fi
+# Same caches, different hierarchy settings
+for setting in '"inclusion": "inclusive"' '"memory_latency": 100'; do
+    sed "s/^{/{$setting, /" "$configs/hierarchy.json" > "$tmp/other.json"
+    if "$sim" "$tmp/other.json" "$tmp/second.trace" --load-state "$tmp/state.bin" > /dev/null 2>&1; then
+        fail "state-other-hierarchy" "loaded into a hierarchy with $setting"
+    else
+        pass "state-other-hierarchy ($setting)"
+    fi
+done
+head -c 100 "$tmp/state.bin" > "$tmp/truncated.bin"
+if "$sim" "$configs/hierarchy.json" "$tmp/second.trace" --load-state "$tmp/truncated.bin" > /dev/null 2>&1; then
+    fail "state-truncated" "loaded a truncated file"
+else
+    pass "state-truncated"
+fi
+
+# Same-line fast path: matches the full lookup entry by entry, and the output is the plain run's
+expect hierarchy hierarchy.json "$configs/hierarchy.json" "$trace"
+expect fast-path hierarchy.json "$configs/hierarchy.json" "$trace" --check-fast-path
+
+# Batched direct-mapped engine: the batched run, the per-entry engine (--check-fast-path does not
+# batch) and the generic engine behind the sparse store all agree
+expect direct-batched direct.json "$configs/direct.json" "$trace"
+expect direct-unbatched direct.json "$configs/direct.json" "$trace" --check-fast-path
+expect direct-generic direct.json "$configs/direct_sparse.json" "$trace"
+
+# Mixed line sizes: a store spanning two write-through L1 lines inside one L2 line reaches L2 and
+# memory twice, once per L1 line
+printf '0000000000400000 0000000010000038 W 010\n' > "$tmp/span.trace"
+"$sim" "$configs/write_through_lines.json" "$tmp/span.trace" > "$tmp/span.out"
+writes=$(grep '"main_memory_writes":' "$tmp/span.out" | tr -dc '0-9')
+if [ "$writes" = "2" ]; then pass "mixed-lines-stores"; else fail "mixed-lines-stores" "$writes memory writes, expected 2"; fi
+
+# Warmup until full: an index matrix of rank 5 reaches 32 of the 64 sets, and the warmup still ends
+printf '{"caches": [{"name": "L1", "size": 4096, "line_size": 64, "kind": "direct", "index": "xor_matrix", "index_matrix": ["0x1", "0x2", "0x4", "0x8", "0x10", "0x10"]}]}' \
+    > "$tmp/singular.json"
+"$sim" "$tmp/singular.json" "$trace" --warmup-until-full > "$tmp/singular.out" 2> /dev/null
+if grep -q '"full": true' "$tmp/singular.out"; then
+    pass "warmup-singular-matrix"
+else
+    fail "warmup-singular-matrix" "the warmup used up the trace"
+fi
+
+# Multi-core with three private levels: core 0 writes a line, L2 loses it and L1 evicts it while
+# only L3 holds it, so the dirty data must land in L3 and leave from there
+expect multicore multicore.json "$configs/multicore.json" "$dir/traces/private_writeback.trace" "$dir/traces/other_core.trace"
+l3_writebacks=$(grep -B 1 '"name": "L3"' "$tmp/multicore.out" | grep -m 1 '"writebacks":' | tr -dc '0-9')
+if [ "$l3_writebacks" = "1" ]; then
+    pass "multicore-private-writeback"
+else
+    fail "multicore-private-writeback" "core 0 L3 wrote back ${l3_writebacks:-nothing}, expected 1"
+fi
+
+if [ $failures -ne 0 ]; then
+    echo "$failures failed"
+    exit 1
+fi
+echo "All tests passed"